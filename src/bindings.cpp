@@ -3,6 +3,8 @@
 #include <madrona/macros.hpp>
 #include <madrona/py/bindings.hpp>
 
+#include <stdexcept>
+
 #if defined(MADRONA_CLANG) || defined(MADRONA_GCC)
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Weverything"
@@ -20,6 +22,25 @@ namespace GPUHideSeek {
 NB_MODULE(gpu_hideseek, m) {
     madrona::py::setupMadronaSubmodule(m);
 
+    nb::class_<Manager::EvaluationResult>(m, "EvaluationResult")
+        .def_ro("num_episodes", &Manager::EvaluationResult::numEpisodes)
+        .def_ro("hider_win_rate", &Manager::EvaluationResult::hiderWinRate)
+        .def_ro("mean_hider_team_return",
+                &Manager::EvaluationResult::meanHiderTeamReturn)
+        .def_ro("mean_hider_seen_steps",
+                &Manager::EvaluationResult::meanHiderSeenSteps)
+        .def_ro("mean_grabs", &Manager::EvaluationResult::meanGrabs)
+        .def_ro("mean_locks", &Manager::EvaluationResult::meanLocks)
+        .def_ro("mean_out_of_bounds",
+                &Manager::EvaluationResult::meanOutOfBounds)
+    ;
+
+    // Actions come from a host [T, num_worlds * 6, 5] int32 table, where
+    // step t of every episode uses row t % T. The GIL is released for the
+    // whole evaluation.
+    using ActionTable =
+        nb::ndarray<int32_t, nb::c_contig, nb::device::cpu>;
+
     nb::class_<Manager> (m, "HideAndSeekSimulator")
         .def("__init__", [](Manager *self,
                             madrona::py::PyExecMode exec_mode,
@@ -29,7 +50,16 @@ NB_MODULE(gpu_hideseek, m) {
                             int64_t render_height, 
                             bool auto_reset,
                             bool enable_batch_render,
-                            bool debug_compile) {
+                            bool cpu_depth_render,
+                            bool debug_compile,
+                            bool enable_state_hash,
+                            int64_t num_workers,
+                            int64_t rollout_length,
+                            bool scripted_policies,
+                            const char *frozen_policy_path,
+                            bool frozen_policy_hiders,
+                            int64_t num_policies,
+                            bool team_major_layout) {
             new (self) Manager(Manager::Config {
                 .execMode = exec_mode,
                 .gpuID = (int)gpu_id,
@@ -38,7 +68,17 @@ NB_MODULE(gpu_hideseek, m) {
                 .renderHeight = (uint32_t)render_height,
                 .autoReset = auto_reset,
                 .enableBatchRender = enable_batch_render,
+                .cpuDepthRender = cpu_depth_render,
                 .debugCompile = debug_compile,
+                .enableStateHash = enable_state_hash,
+                .numWorkers = (uint32_t)num_workers,
+                .rolloutLength = (uint32_t)rollout_length,
+                .scriptedPolicies = scripted_policies,
+                .frozenPolicyPath = frozen_policy_path[0] != '\0' ?
+                    frozen_policy_path : nullptr,
+                .frozenPolicyHiders = frozen_policy_hiders,
+                .numPolicies = (uint32_t)num_policies,
+                .teamMajorLayout = team_major_layout,
             });
         }, nb::arg("exec_mode"),
            nb::arg("gpu_id"),
@@ -47,7 +87,16 @@ NB_MODULE(gpu_hideseek, m) {
            nb::arg("render_height"),
            nb::arg("auto_reset") = false,
            nb::arg("enable_batch_render") = false,
-           nb::arg("debug_compile") = false)
+           nb::arg("cpu_depth_render") = false,
+           nb::arg("debug_compile") = false,
+           nb::arg("enable_state_hash") = false,
+           nb::arg("num_workers") = 0,
+           nb::arg("rollout_length") = 0,
+           nb::arg("scripted_policies") = false,
+           nb::arg("frozen_policy_path") = "",
+           nb::arg("frozen_policy_hiders") = false,
+           nb::arg("num_policies") = 0,
+           nb::arg("team_major_layout") = false)
         .def("step", &Manager::step)
         .def("reset_tensor", &Manager::resetTensor)
         .def("done_tensor", &Manager::doneTensor)
@@ -67,6 +116,92 @@ NB_MODULE(gpu_hideseek, m) {
         .def("rgb_tensor", &Manager::rgbTensor)
         .def("lidar_tensor", &Manager::lidarTensor)
         .def("seed_tensor", &Manager::seedTensor)
+        .def("world_seed_tensor", &Manager::worldSeedTensor)
+        .def("state_hash_tensor", &Manager::stateHashTensor)
+        .def("occupancy_grid_tensor", &Manager::occupancyGridTensor)
+        .def("episode_stats_tensor", &Manager::episodeStatsTensor)
+        .def("scripted_agents_tensor", &Manager::scriptedAgentsTensor)
+        .def("policy_assignment_tensor", &Manager::policyAssignmentTensor)
+        .def("policy_permutation_tensor",
+             &Manager::policyPermutationTensor)
+        .def("policy_offsets_tensor", &Manager::policyOffsetsTensor)
+        .def("team_prep_counter_tensor", &Manager::teamPrepCounterTensor)
+        .def("team_agent_type_tensor", &Manager::teamAgentTypeTensor)
+        .def("team_agent_mask_tensor", &Manager::teamAgentMaskTensor)
+        .def("team_agent_data_tensor", &Manager::teamAgentDataTensor)
+        .def("team_box_data_tensor", &Manager::teamBoxDataTensor)
+        .def("team_ramp_data_tensor", &Manager::teamRampDataTensor)
+        .def("team_visible_agents_mask_tensor",
+             &Manager::teamVisibleAgentsMaskTensor)
+        .def("team_visible_boxes_mask_tensor",
+             &Manager::teamVisibleBoxesMaskTensor)
+        .def("team_visible_ramps_mask_tensor",
+             &Manager::teamVisibleRampsMaskTensor)
+        .def("team_lidar_tensor", &Manager::teamLidarTensor)
+        .def("team_action_tensor", &Manager::teamActionTensor)
+        .def("team_reward_tensor", &Manager::teamRewardTensor)
+        .def("team_done_tensor", &Manager::teamDoneTensor)
+        .def("set_world_seed", &Manager::setWorldSeed)
+        .def("run_evaluation", [](Manager &mgr,
+                                  int64_t num_episodes,
+                                  ActionTable action_table,
+                                  int64_t num_hiders,
+                                  int64_t num_seekers) {
+            if (action_table.ndim() != 3 || action_table.shape(0) == 0 ||
+                    action_table.shape(1) != size_t(mgr.numWorlds()) * 6 ||
+                    action_table.shape(2) != 5) {
+                throw std::invalid_argument(
+                    "action_table must be [T, num_worlds * 6, 5]");
+            }
+
+            const int32_t *actions = action_table.data();
+            int64_t num_table_steps = (int64_t)action_table.shape(0);
+            int64_t num_step_elems = (int64_t)action_table.shape(1) * 5;
+
+            // The table rows follow team_action_tensor() in team mode,
+            // which has the same number of rows as action_tensor().
+            bool team_major = mgr.teamMajorLayout();
+
+            nb::gil_scoped_release no_gil;
+
+            return mgr.runEvaluation(num_episodes, num_hiders, num_seekers,
+                [&](int64_t episode_step) {
+                    const int32_t *step_actions = actions +
+                        (episode_step % num_table_steps) * num_step_elems;
+
+                    if (team_major) {
+                        mgr.setTeamActions(step_actions);
+                    } else {
+                        mgr.setActions(step_actions);
+                    }
+                });
+        }, nb::arg("num_episodes"),
+           nb::arg("action_table"),
+           nb::arg("num_hiders") = 3,
+           nb::arg("num_seekers") = 2)
+        .def("rollout_prep_counter_tensor",
+             &Manager::rolloutPrepCounterTensor)
+        .def("rollout_agent_type_tensor", &Manager::rolloutAgentTypeTensor)
+        .def("rollout_agent_mask_tensor", &Manager::rolloutAgentMaskTensor)
+        .def("rollout_agent_data_tensor", &Manager::rolloutAgentDataTensor)
+        .def("rollout_box_data_tensor", &Manager::rolloutBoxDataTensor)
+        .def("rollout_ramp_data_tensor", &Manager::rolloutRampDataTensor)
+        .def("rollout_visible_agents_mask_tensor",
+             &Manager::rolloutVisibleAgentsMaskTensor)
+        .def("rollout_visible_boxes_mask_tensor",
+             &Manager::rolloutVisibleBoxesMaskTensor)
+        .def("rollout_visible_ramps_mask_tensor",
+             &Manager::rolloutVisibleRampsMaskTensor)
+        .def("rollout_lidar_tensor", &Manager::rolloutLidarTensor)
+        .def("rollout_action_tensor", &Manager::rolloutActionTensor)
+        .def("rollout_reward_tensor", &Manager::rolloutRewardTensor)
+        .def("rollout_done_tensor", &Manager::rolloutDoneTensor)
+        .def("rollout_steps_recorded", &Manager::rolloutStepsRecorded)
+        .def("rollout_value_tensor", &Manager::rolloutValueTensor)
+        .def("rollout_advantage_tensor", &Manager::rolloutAdvantageTensor)
+        .def("rollout_return_tensor", &Manager::rolloutReturnTensor)
+        .def("compute_advantages", &Manager::computeAdvantages,
+             nb::arg("gamma"), nb::arg("gae_lambda"))
     ;
 }
 
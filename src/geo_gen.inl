@@ -16,6 +16,7 @@ madrona::Entity makeDynObject(Engine &ctx,
     Entity e = ctx.makeEntity<DynamicObject>();
     ctx.get<Position>(e) = pos;
     ctx.get<Rotation>(e) = rot;
+    ctx.get<Yaw>(e).yaw = quatToYaw(rot);
     ctx.get<Scale>(e) = scale;
     ctx.get<ObjectID>(e) = ObjectID { obj_id };
     ctx.get<phys::broadphase::LeafID>(e) =
@@ -26,6 +27,10 @@ madrona::Entity makeDynObject(Engine &ctx,
     };
     ctx.get<ResponseType>(e) = response_type;
     ctx.get<OwnerTeam>(e) = owner_team;
+    ctx.get<SleepState>(e) = {
+        .numQuietSteps = 0,
+        .asleep = 0,
+    };
     ctx.get<ExternalForce>(e) = Vector3::zero();
     ctx.get<ExternalTorque>(e) = Vector3::zero();
 
@@ -22,12 +22,125 @@ using namespace madrona::viz;
             sizeof(uint32_t) * total_num_steps * 2 * 3);
 }
 
+// Steps a single-threaded and a fully threaded CPU manager in lockstep with
+// the same random actions and compares their per-world state hashes.
+static int checkDeterminism(uint32_t num_worlds, uint64_t num_steps)
+{
+    using namespace GPUHideSeek;
+
+    auto makeManager = [num_worlds](uint32_t num_workers) {
+        return Manager({
+            .execMode = ExecMode::CPU,
+            .gpuID = 0,
+            .numWorlds = num_worlds,
+            .autoReset = true,
+            .enableStateHash = true,
+            .numWorkers = num_workers,
+        });
+    };
+
+    Manager serial_mgr = makeManager(1);
+    Manager parallel_mgr = makeManager(0);
+
+    auto serial_hashes =
+        (const uint64_t *)serial_mgr.stateHashTensor().devicePtr();
+    auto parallel_hashes =
+        (const uint64_t *)parallel_mgr.stateHashTensor().devicePtr();
+
+    // Every world starts with 3 hiders and 2 seekers, packed per world.
+    constexpr CountT agents_per_world = 5;
+
+    std::mt19937 rand_gen(0);
+    std::uniform_int_distribution<int32_t> act_rand(0, 10);
+    std::uniform_int_distribution<int32_t> flag_rand(0, 9);
+
+    for (uint64_t step = 0; step <= num_steps; step++) {
+        for (uint32_t world_idx = 0; world_idx < num_worlds; world_idx++) {
+            if (serial_hashes[world_idx] != parallel_hashes[world_idx]) {
+                printf("Mismatch at step %lu, world %u: %lx vs %lx\n",
+                       (unsigned long)step, world_idx,
+                       (unsigned long)serial_hashes[world_idx],
+                       (unsigned long)parallel_hashes[world_idx]);
+                return 1;
+            }
+        }
+
+        if (step == num_steps) {
+            break;
+        }
+
+        for (CountT i = 0; i < (CountT)num_worlds * agents_per_world; i++) {
+            int32_t x = act_rand(rand_gen);
+            int32_t y = act_rand(rand_gen);
+            int32_t r = act_rand(rand_gen);
+            bool g = flag_rand(rand_gen) == 0;
+            bool l = flag_rand(rand_gen) == 0;
+
+            serial_mgr.setAction(i, x, y, r, g, l);
+            parallel_mgr.setAction(i, x, y, r, g, l);
+        }
+
+        serial_mgr.step();
+        parallel_mgr.step();
+    }
+
+    printf("State hashes match across %lu steps\n", (unsigned long)num_steps);
+    return 0;
+}
+
+// Resets every world into each debug level in turn and steps it with random
+// actions. The debug levels spawn camera agents, which the training level
+// never does, so this exercises the per-step systems on them.
+static int checkDebugLevels(ExecMode exec_mode, uint32_t num_worlds,
+                            uint64_t num_steps)
+{
+    using namespace GPUHideSeek;
+
+    Manager mgr({
+        .execMode = exec_mode,
+        .gpuID = 0,
+        .numWorlds = num_worlds,
+        .autoReset = false,
+    });
+
+    std::mt19937 rand_gen(0);
+    std::uniform_int_distribution<int32_t> act_rand(0, 10);
+
+    // Every world has 6 agent slots with 5 action values each.
+    HeapArray<int32_t> actions(num_worlds * 6 * 5);
+
+    for (CountT level_idx = 2; level_idx <= 8; level_idx++) {
+        for (CountT world_idx = 0; world_idx < (CountT)num_worlds;
+             world_idx++) {
+            mgr.triggerReset(world_idx, level_idx, 0, 0);
+        }
+
+        for (uint64_t step = 0; step < num_steps; step++) {
+            for (CountT i = 0; i < (CountT)num_worlds * 6; i++) {
+                actions[i * 5] = act_rand(rand_gen);
+                actions[i * 5 + 1] = act_rand(rand_gen);
+                actions[i * 5 + 2] = act_rand(rand_gen);
+                actions[i * 5 + 3] = 0;
+                actions[i * 5 + 4] = 0;
+            }
+
+            mgr.setActions(actions.data());
+            mgr.step();
+        }
+
+        printf("Stepped debug level %ld for %lu steps\n",
+               (long)level_idx, (unsigned long)num_steps);
+    }
+
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     using namespace GPUHideSeek;
 
     if (argc < 4) {
-        fprintf(stderr, "%s TYPE NUM_WORLDS NUM_STEPS [--rand-actions]\n", argv[0]);
+        fprintf(stderr, "%s TYPE NUM_WORLDS NUM_STEPS [--rand-actions] [--check-determinism] [--debug-levels]\n", argv[0]);
         return -1;
     }
     std::string type(argv[1]);
@@ -49,10 +162,30 @@ int main(int argc, char *argv[])
         num_worlds * 2 * num_steps * 3);
 
     bool rand_actions = false;
-    if (argc >= 5) {
-        if (std::string(argv[4]) == "--rand-actions") {
+    bool check_determinism = false;
+    bool debug_levels = false;
+    for (int i = 4; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "--rand-actions") {
             rand_actions = true;
+        } else if (arg == "--check-determinism") {
+            check_determinism = true;
+        } else if (arg == "--debug-levels") {
+            debug_levels = true;
+        }
+    }
+
+    if (check_determinism) {
+        if (exec_mode != ExecMode::CPU) {
+            fprintf(stderr, "--check-determinism requires CPU\n");
+            return -1;
         }
+
+        return checkDeterminism((uint32_t)num_worlds, num_steps);
+    }
+
+    if (debug_levels) {
+        return checkDebugLevels(exec_mode, (uint32_t)num_worlds, num_steps);
     }
 
     Manager mgr({
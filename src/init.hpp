@@ -6,12 +6,57 @@
 
 namespace GPUHideSeek {
 
-struct EpisodeManager {
-    madrona::AtomicU32 curEpisode;
+// Per agent arrays allocated by the Manager, each with the same per agent
+// layout as the matching exported tensor.
+struct AgentBuffers {
+    int32_t *prepCounters;
+    int32_t *agentTypes;
+    float *agentMasks;
+    float *agentData;
+    float *boxData;
+    float *rampData;
+    float *visibleAgents;
+    float *visibleBoxes;
+    float *visibleRamps;
+    float *lidar;
+    int32_t *actions;
+    float *rewards;
+    uint8_t *dones;
+};
+
+// Rollout ring owned by the Manager, shared by every world. Each array is
+// [length, numAgentSlots, ...], where agent slot i of world w is row
+// w * maxAgents + i. curStep holds the ring index written on the current
+// step, or -1 to skip recording.
+struct RolloutBuffers {
+    int32_t *curStep;
+    int32_t length;
+    int32_t numAgentSlots;
+    AgentBuffers agents;
+};
+
+// Team-major mirror of the exported agent tensors, [2 * numWorlds * 3, ...]:
+// hider k of world w is row w * 3 + k and seeker k is row
+// numWorlds * 3 + w * 3 + k. Rows without an agent are zeroed.
+struct TeamBuffers {
+    int32_t numWorlds;
+    AgentBuffers agents;
+};
+
+// Packed weights of the frozen MLP policy (see loadFrozenPolicy() in mgr.cpp
+// for the file format). Layer i is a row-major [dims[i + 1], dims[i]] weight
+// matrix followed by its dims[i + 1] biases; every layer but the last is
+// followed by a ReLU.
+struct MLPWeights {
+    static constexpr int32_t maxLayers = 4;
+    static constexpr int32_t maxWidth = 256;
+
+    const float *params;
+    int32_t numLayers;
+    int32_t dims[maxLayers + 1];
 };
 
 struct WorldInit {
-    EpisodeManager *episodeMgr;
     float *rewardBuffer;
     uint8_t *doneBuffer;
     madrona::phys::ObjectManager *rigidBodyObjMgr;
@@ -19,6 +64,12 @@ struct WorldInit {
     uint32_t maxEntitiesPerWorld;
     const madrona::viz::VizECSBridge *vizBridge;
     const madrona::render::BatchRendererECSBridge *batchRenderBridge;
+    float *depthBuffer;
+    uint32_t depthWidth;
+    uint32_t depthHeight;
+    RolloutBuffers rollout;
+    MLPWeights frozenPolicy;
+    TeamBuffers team;
 };
 
 }
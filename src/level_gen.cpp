@@ -26,7 +26,11 @@ static Entity makeAgent(Engine &ctx, AgentType agent_type)
         ctx.data().hiders[ctx.data().numHiders++] = agent;
     }
 
-    ctx.get<Seed>(agent_iface).seed = ctx.data().curEpisodeSeed;
+    ctx.get<Seed>(agent_iface) = ctx.data().curEpisodeSeed;
+    ctx.get<ScriptedMemory>(agent_iface) = {
+        .lastSeenPos = Vector2 { 0, 0 },
+        .stepsSinceSeen = -1,
+    };
 
     // Zero out actions
     ctx.get<Action>(agent_iface) = {
@@ -96,115 +100,79 @@ static void generateTrainingEnvironment(Engine &ctx,
         return true;
     };
 
+    // Candidate placements are drawn a batch at a time as independent
+    // counter-based samples, then tested in order. The first candidate that
+    // doesn't overlap anything is used; after max_rejections misses the next
+    // candidate is taken regardless.
     const CountT max_rejections = 20;
+    constexpr int32_t placement_batch = 8;
 
-    for (CountT i = 0; i < num_elongated; i++) {
-        CountT rejections = 0;
-        // Choose a random room and put the entity in a random position in that room
-        while (true) {
-            float bounds_diffx = bounds.y - bounds.x;
-            float bounds_diffy = bounds.y - bounds.x;
-
-            Vector3 pos {
-                bounds.x + rng.rand() * bounds_diffx,
-                bounds.x + rng.rand() * bounds_diffy,
-                1.0f,
-            };
-
-            float box_rotation = rng.rand() * math::pi;
-            const auto rot = Quat::angleAxis(box_rotation, {0, 0, 1});
-            Diag3x3 scale = {1.0f, 1.0f, 1.0f};
-
-            AABB aabb = obj_mgr.rigidBodyAABBs[6];
-            aabb = aabb.applyTRS(pos, rot, scale);
-
-            // Check overlap with all other entities
-            if (checkOverlap(aabb) || rejections == max_rejections) {
-                ctx.data().boxes[i] = all_entities[num_entities++] =
-                    makeDynObject(ctx, pos, rot, 6);
-
-                ctx.data().boxSizes[i] = { 8, 1.5 };
-                ctx.data().boxRotations[i] = box_rotation;
-                break;
-            }
+    struct Placement {
+        Vector3 pos;
+        Quat rot;
+        float rotation;
+    };
 
-            rejections++;
-        }
-    }
+    auto findPlacement = [&](int32_t obj_id) {
+        AABB obj_aabb = obj_mgr.rigidBodyAABBs[obj_id];
+        Diag3x3 scale = {1.0f, 1.0f, 1.0f};
 
-    for (CountT i = 0; i < num_cubes; i++) {
         CountT rejections = 0;
         while (true) {
-            float bounds_diffx = bounds.y - bounds.x;
-            float bounds_diffy = bounds.y - bounds.x;
+            float samples[3 * placement_batch];
+            rng.rand(samples, 3 * placement_batch);
 
-#if 0
-            Vector3 pos {
-                room->low.x + rng.rand() * bounds_diffx,
-                room->low.y + rng.rand() * bounds_diffy,
-                1.0f,
-            };
-#endif
+            for (int32_t i = 0; i < placement_batch; i++) {
+                Vector3 pos {
+                    bounds.x + samples[i] * bounds_diff,
+                    bounds.x + samples[placement_batch + i] * bounds_diff,
+                    1.0f,
+                };
+
+                float rotation = samples[2 * placement_batch + i] * math::pi;
+                Quat rot = Quat::angleAxis(rotation, {0, 0, 1});
+
+                AABB aabb = obj_aabb.applyTRS(pos, rot, scale);
+
+                if (checkOverlap(aabb) || rejections == max_rejections) {
+                    return Placement { pos, rot, rotation };
+                }
 
-            Vector3 pos {
-                bounds.x + rng.rand() * bounds_diffx,
-                bounds.x + rng.rand() * bounds_diffy,
-                1.0f,
-            };
+                rejections++;
+            }
+        }
+    };
 
-            float box_rotation = rng.rand() * math::pi;
-            const auto rot = Quat::angleAxis(box_rotation, {0, 0, 1});
-            Diag3x3 scale = {1.0f, 1.0f, 1.0f};
+    for (CountT i = 0; i < num_elongated; i++) {
+        Placement placement = findPlacement(6);
 
-            AABB aabb = obj_mgr.rigidBodyAABBs[2];
-            aabb = aabb.applyTRS(pos, rot, scale);
+        ctx.data().boxes[i] = all_entities[num_entities++] =
+            makeDynObject(ctx, placement.pos, placement.rot, 6);
 
-            if (checkOverlap(aabb) || rejections == max_rejections) {
-                CountT box_idx = i + num_elongated;
+        ctx.data().boxSizes[i] = { 8, 1.5 };
+        ctx.data().boxRotations[i] = placement.rotation;
+    }
 
-                ctx.data().boxes[box_idx] = all_entities[num_entities++] =
-                    makeDynObject(ctx, pos, rot, 2);
+    for (CountT i = 0; i < num_cubes; i++) {
+        Placement placement = findPlacement(2);
+        CountT box_idx = i + num_elongated;
 
-                ctx.data().boxSizes[box_idx] = { 2, 2 };
-                ctx.data().boxRotations[box_idx] = box_rotation;
-                break;
-            }
+        ctx.data().boxes[box_idx] = all_entities[num_entities++] =
+            makeDynObject(ctx, placement.pos, placement.rot, 2);
 
-            ++rejections;
-        }
+        ctx.data().boxSizes[box_idx] = { 2, 2 };
+        ctx.data().boxRotations[box_idx] = placement.rotation;
     }
 
     ctx.data().numActiveBoxes = total_num_boxes;
 
     const CountT num_ramps = consts::maxRamps;
     for (CountT i = 0; i < num_ramps; i++) {
-        CountT rejections = 0;
-        while (true) {
-            float bounds_diffx = bounds.y - bounds.x;
-            float bounds_diffy = bounds.y - bounds.x;
-
-            Vector3 pos {
-                bounds.x + rng.rand() * bounds_diffx,
-                bounds.x + rng.rand() * bounds_diffy,
-                1.0f,
-            };
-
-            float ramp_rotation = rng.rand() * math::pi;
-            const auto rot = Quat::angleAxis(ramp_rotation, {0, 0, 1});
-            Diag3x3 scale = {1.0f, 1.0f, 1.0f};
-
-            AABB aabb = obj_mgr.rigidBodyAABBs[5];
-            aabb = aabb.applyTRS(pos, rot, scale);
-
-            if (checkOverlap(aabb) || rejections == max_rejections) {
-                ctx.data().ramps[i] = all_entities[num_entities++] =
-                    makeDynObject(ctx, pos, rot, 5);
-                ctx.data().rampRotations[i] = ramp_rotation;
-                break;
-            }
+        Placement placement = findPlacement(5);
 
-            ++rejections;
-        }
+        ctx.data().ramps[i] = all_entities[num_entities++] =
+            makeDynObject(ctx, placement.pos, placement.rot, 5);
+        ctx.data().rampRotations[i] = placement.rotation;
     }
     ctx.data().numActiveRamps = num_ramps;
 
@@ -214,6 +182,7 @@ static void generateTrainingEnvironment(Engine &ctx,
             is_hider ? AgentType::Hider : AgentType::Seeker);
         ctx.get<Position>(agent) = pos;
         ctx.get<Rotation>(agent) = rot;
+        ctx.get<Yaw>(agent).yaw = quatToYaw(rot);
         ctx.get<Scale>(agent) = Diag3x3 { 1, 1, 1 };
         if (ctx.data().enableBatchRender) {
             ctx.get<render::BatchRenderCamera>(agent) =
@@ -247,50 +216,13 @@ static void generateTrainingEnvironment(Engine &ctx,
     };
 
     for (CountT i = 0; i < num_hiders; i++) {
-        CountT rejections = 0;
-        while (true) {
-            Vector3 pos {
-                bounds.x + rng.rand() * bounds_diff,
-                bounds.x + rng.rand() * bounds_diff,
-                1.f,
-            };
-
-            const auto rot = Quat::angleAxis(rng.rand() * math::pi, {0, 0, 1});
-            Diag3x3 scale = {1.0f, 1.0f, 1.0f};
-
-            AABB aabb = obj_mgr.rigidBodyAABBs[4];
-            aabb = aabb.applyTRS(pos, rot, scale);
-            if (checkOverlap(aabb) || rejections == max_rejections) {
-                makeDynAgent(pos, rot, true, i);
-                break;
-            }
-
-            rejections++;
-        }
+        Placement placement = findPlacement(4);
+        makeDynAgent(placement.pos, placement.rot, true, i);
     }
 
     for (CountT i = 0; i < num_seekers; i++) {
-        CountT rejections = 0;
-        while (true) {
-            Vector3 pos {
-                bounds.x + rng.rand() * bounds_diff,
-                bounds.x + rng.rand() * bounds_diff,
-                1.f,
-            };
-
-            const auto rot = Quat::angleAxis(rng.rand() * math::pi, {0, 0, 1});
-            Diag3x3 scale = {1.0f, 1.0f, 1.0f};
-
-            AABB aabb = obj_mgr.rigidBodyAABBs[4];
-            aabb = aabb.applyTRS(pos, rot, scale);
-
-            if (checkOverlap(aabb) || rejections == max_rejections) {
-                makeDynAgent(pos, rot, false, num_hiders + i);
-                break;
-            }
-
-            rejections++;
-        }
+        Placement placement = findPlacement(4);
+        makeDynAgent(placement.pos, placement.rot, false, num_hiders + i);
     }
 
     all_entities[num_entities++] =
@@ -311,23 +243,60 @@ static void generateTrainingEnvironment(Engine &ctx,
 
 static void generateDebugEnvironment(Engine &ctx, CountT level_id);
 
+// Record the axis aligned static walls of the freshly generated level for
+// the occupancy grid.
+static void captureStaticGeometry(Engine &ctx)
+{
+    const ObjectManager &obj_mgr = *ctx.singleton<ObjectData>().mgr;
+    StaticGeometry &geo = ctx.singleton<StaticGeometry>();
+
+    geo.numBoxes = 0;
+
+    Entity *all_entities = ctx.data().obstacles;
+    for (CountT i = 0; i < ctx.data().numObstacles; i++) {
+        Entity e = all_entities[i];
+        if (ctx.get<ResponseType>(e) != ResponseType::Static) {
+            continue;
+        }
+
+        int32_t obj_id = ctx.get<ObjectID>(e).idx;
+        if (obj_id != 2 && obj_id != 3 && obj_id != 6) {
+            continue;
+        }
+
+        Quat rot = ctx.get<Rotation>(e);
+        bool axis_aligned = fabsf(rot.w) > 0.99999f;
+        if (!axis_aligned || geo.numBoxes == consts::maxStaticBoxes) {
+            continue;
+        }
+
+        CountT box_idx = geo.numBoxes++;
+        geo.boxes[box_idx] = obj_mgr.rigidBodyAABBs[obj_id].applyTRS(
+            ctx.get<Position>(e), rot, ctx.get<Scale>(e));
+    }
+}
+
 void generateEnvironment(Engine &ctx,
                          CountT level_id,
                          CountT num_hiders,
                          CountT num_seekers)
 {
-    EpisodeManager &episode_mgr = *ctx.data().episodeMgr;
-    uint32_t episode_idx =
-        episode_mgr.curEpisode.fetch_add<sync::relaxed>(1);
-    ctx.data().rng = RNG::make(episode_idx);
+    WorldSeed &world_seed = ctx.singleton<WorldSeed>();
+    uint32_t episode_idx = world_seed.episodeIdx++;
+    ctx.data().rng = RNG::make(world_seed.baseSeed, episode_idx);
 
-    ctx.data().curEpisodeSeed = episode_idx;
+    ctx.data().curEpisodeSeed = {
+        .worldSeed = (int32_t)world_seed.baseSeed,
+        .episodeIdx = (int32_t)episode_idx,
+    };
 
     if (level_id == 1) {
         generateTrainingEnvironment(ctx, num_hiders, num_seekers);
     } else {
         generateDebugEnvironment(ctx, level_id);
     }
+
+    captureStaticGeometry(ctx);
 }
 
 static void singleCubeLevel(Engine &ctx, Vector3 pos, Quat rot)
@@ -512,6 +481,7 @@ static void level6(Engine &ctx)
             is_hider ? AgentType::Hider : AgentType::Seeker);
         ctx.get<Position>(agent) = pos;
         ctx.get<Rotation>(agent) = rot;
+        ctx.get<Yaw>(agent).yaw = quatToYaw(rot);
         ctx.get<Scale>(agent) = Diag3x3 { 1, 1, 1 };
         if (ctx.data().enableBatchRender) {
             ctx.get<render::BatchRenderCamera>(agent) =
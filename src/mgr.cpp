@@ -13,6 +13,7 @@
 #include <filesystem>
 #include <fstream>
 #include <string>
+#include <vector>
 
 #ifdef MADRONA_CUDA_SUPPORT
 #include <madrona/mw_gpu.hpp>
@@ -29,16 +30,32 @@ namespace GPUHideSeek {
 struct Manager::Impl {
     Config cfg;
     PhysicsLoader physicsLoader;
-    EpisodeManager *episodeMgr;
     WorldReset *resetsPointer;
+    WorldSeed *seedsPointer;
     Action *actionsPointer;
+    CompletedEpisodeStats *episodeStatsPointer;
+    PolicyGroupKeys *policyKeysPointer;
     float *rewardsBuffer;
     uint8_t *donesBuffer;
+    float *depthBuffer;
+    RolloutBuffers rollout;
+    int64_t numRolloutSteps;
+    float *rolloutValues;
+    float *rolloutAdvantages;
+    float *rolloutReturns;
+    TeamBuffers team;
+    MLPWeights frozenPolicy;
+    int32_t *policyPermutation; // CPU only, like the offsets
+    int32_t *policyOffsets;
 
     static inline Impl * init(
         const Config &cfg,
         const viz::VizECSBridge *viz_bridge,
         const render::BatchRendererECSBridge *batch_render_bridge);
+
+    // Runs after the derived executor is destroyed, so nothing is still
+    // reading the buffers it frees.
+    inline ~Impl();
 };
 
 struct Manager::CPUImpl : Manager::Impl {
@@ -181,13 +198,367 @@ static void loadPhysicsObjects(PhysicsLoader &loader)
     }
 
     // HACK:
-    rigid_body_assets.metadatas[4].mass.invInertiaTensor.x = 0.f,
-    rigid_body_assets.metadatas[4].mass.invInertiaTensor.y = 0.f,
+    rigid_body_assets.metadatas[4].mass.invInertiaTensor.x = 0.f;
+    rigid_body_assets.metadatas[4].mass.invInertiaTensor.y = 0.f;
 
     loader.loadRigidBodies(rigid_body_assets);
     free(rigid_body_data);
 }
 
+// Allocates num_rows rows of every per agent array with alloc_fn.
+template <typename Fn>
+static AgentBuffers allocAgentBuffers(CountT num_rows, Fn &&alloc_fn)
+{
+    auto allocRows = [&](size_t num_row_bytes) {
+        return alloc_fn(num_row_bytes * num_rows);
+    };
+
+    AgentBuffers bufs;
+    bufs.prepCounters = (int32_t *)allocRows(sizeof(AgentPrepCounter));
+    bufs.agentTypes = (int32_t *)allocRows(sizeof(AgentType));
+    bufs.agentMasks = (float *)allocRows(sizeof(AgentActiveMask));
+    bufs.agentData = (float *)allocRows(sizeof(RelativeAgentObservations));
+    bufs.boxData = (float *)allocRows(sizeof(RelativeBoxObservations));
+    bufs.rampData = (float *)allocRows(sizeof(RelativeRampObservations));
+    bufs.visibleAgents = (float *)allocRows(sizeof(AgentVisibilityMasks));
+    bufs.visibleBoxes = (float *)allocRows(sizeof(BoxVisibilityMasks));
+    bufs.visibleRamps = (float *)allocRows(sizeof(RampVisibilityMasks));
+    bufs.lidar = (float *)allocRows(sizeof(Lidar));
+    bufs.actions = (int32_t *)allocRows(sizeof(Action));
+    bufs.rewards = (float *)allocRows(sizeof(float));
+    bufs.dones = (uint8_t *)allocRows(sizeof(uint8_t));
+
+    return bufs;
+}
+
+// Allocates every rollout array with alloc_fn. All pointers stay null when
+// the rollout buffer is disabled.
+template <typename Fn>
+static RolloutBuffers allocRolloutBuffers(const Manager::Config &cfg,
+                                          Fn &&alloc_fn)
+{
+    RolloutBuffers rollout {};
+    if (cfg.rolloutLength == 0) {
+        return rollout;
+    }
+
+    rollout.length = (int32_t)cfg.rolloutLength;
+    rollout.numAgentSlots = (int32_t)(cfg.numWorlds * consts::maxAgents);
+    rollout.curStep = (int32_t *)alloc_fn(sizeof(int32_t));
+    rollout.agents = allocAgentBuffers(
+        CountT(rollout.length) * CountT(rollout.numAgentSlots), alloc_fn);
+
+    return rollout;
+}
+
+// Allocates the team-major mirror of the agent arrays. All pointers stay
+// null when the layout is disabled. upload_fn copies host data into an
+// allocation, used to start every agent on the idle action.
+template <typename AllocFn, typename UploadFn>
+static TeamBuffers allocTeamBuffers(const Manager::Config &cfg,
+                                    AllocFn &&alloc_fn, UploadFn &&upload_fn)
+{
+    TeamBuffers team {};
+    if (!cfg.teamMajorLayout) {
+        return team;
+    }
+
+    CountT num_rows = CountT(cfg.numWorlds) * consts::maxAgents;
+
+    team.numWorlds = (int32_t)cfg.numWorlds;
+    team.agents = allocAgentBuffers(num_rows, alloc_fn);
+
+    HeapArray<Action> idle_actions(num_rows);
+    for (CountT i = 0; i < num_rows; i++) {
+        idle_actions[i] = Action {
+            .x = 5,
+            .y = 5,
+            .r = 5,
+            .g = 0,
+            .l = 0,
+        };
+    }
+
+    upload_fn(team.agents.actions, idle_actions.data(),
+              sizeof(Action) * num_rows);
+
+    return team;
+}
+
+// Frees a buffer allocated for the given backend: device memory from
+// cu::allocGPU under CUDA, malloc otherwise.
+static void freeBuffer(ExecMode exec_mode, const void *ptr)
+{
+    if (ptr == nullptr) {
+        return;
+    }
+
+    if (exec_mode == ExecMode::CUDA) {
+#ifdef MADRONA_CUDA_SUPPORT
+        cu::deallocGPU((void *)ptr);
+#endif
+    } else {
+        free((void *)ptr);
+    }
+}
+
+static void freeAgentBuffers(ExecMode exec_mode, const AgentBuffers &bufs)
+{
+    freeBuffer(exec_mode, bufs.prepCounters);
+    freeBuffer(exec_mode, bufs.agentTypes);
+    freeBuffer(exec_mode, bufs.agentMasks);
+    freeBuffer(exec_mode, bufs.agentData);
+    freeBuffer(exec_mode, bufs.boxData);
+    freeBuffer(exec_mode, bufs.rampData);
+    freeBuffer(exec_mode, bufs.visibleAgents);
+    freeBuffer(exec_mode, bufs.visibleBoxes);
+    freeBuffer(exec_mode, bufs.visibleRamps);
+    freeBuffer(exec_mode, bufs.lidar);
+    freeBuffer(exec_mode, bufs.actions);
+    freeBuffer(exec_mode, bufs.rewards);
+    freeBuffer(exec_mode, bufs.dones);
+}
+
+// computeAdvantages() scans the rollout on the host in place, so it's only
+// offered on the CPU backend. Under CUDA, copying the whole rollout to the
+// host and back would be slower than a scan on the device in the trainer.
+static void checkAdvantagesSupported(const Manager::Config &cfg)
+{
+    if (cfg.rolloutLength == 0) {
+        FATAL("Manager wasn't created with a rollout buffer");
+    }
+
+    if (cfg.execMode != ExecMode::CPU) {
+        FATAL("computeAdvantages is only supported on the CPU backend");
+    }
+}
+
+// Value inputs and advantage / return outputs for computeAdvantages(). Only
+// allocated when computeAdvantages() is supported.
+template <typename Fn>
+static void allocRolloutTargets(const Manager::Config &cfg, Fn &&alloc_fn,
+                                float **values, float **advantages,
+                                float **returns)
+{
+    if (cfg.rolloutLength == 0 || cfg.execMode != ExecMode::CPU) {
+        *values = nullptr;
+        *advantages = nullptr;
+        *returns = nullptr;
+        return;
+    }
+
+    size_t num_agent_slots = size_t(cfg.numWorlds) * consts::maxAgents;
+    size_t num_step_bytes =
+        sizeof(float) * size_t(cfg.rolloutLength) * num_agent_slots;
+
+    *values =
+        (float *)alloc_fn(num_step_bytes + sizeof(float) * num_agent_slots);
+    *advantages = (float *)alloc_fn(num_step_bytes);
+    *returns = (float *)alloc_fn(num_step_bytes);
+}
+
+struct PolicyGroupBuffers {
+    int32_t *permutation;
+    int32_t *offsets;
+};
+
+// Policy grouping sorts the exported keys on the host after every step.
+// Under CUDA that would be a device round trip per step, so it's CPU only.
+static PolicyGroupBuffers allocPolicyGroupBuffers(const Manager::Config &cfg)
+{
+    PolicyGroupBuffers bufs {};
+    if (cfg.numPolicies == 0) {
+        return bufs;
+    }
+
+    if (cfg.execMode != ExecMode::CPU) {
+        FATAL("numPolicies is only supported on the CPU backend");
+    }
+
+    size_t num_agent_slots = size_t(cfg.numWorlds) * consts::maxAgents;
+    size_t num_offsets = 2 * size_t(cfg.numPolicies) + 1;
+
+    bufs.permutation = (int32_t *)malloc(sizeof(int32_t) * num_agent_slots);
+    bufs.offsets = (int32_t *)malloc(sizeof(int32_t) * num_offsets);
+
+    return bufs;
+}
+
+// Stable counting sort of every world's agent slots by group key. row_bases
+// turns per world rows into rows of the packed exported tensors.
+static void sortPolicyGroups(const PolicyGroupKeys *keys,
+                             const int32_t *row_bases,
+                             CountT num_worlds,
+                             CountT num_groups,
+                             int32_t *permutation,
+                             int32_t *offsets)
+{
+    for (CountT g = 0; g <= num_groups; g++) {
+        offsets[g] = 0;
+    }
+
+    for (CountT w = 0; w < num_worlds; w++) {
+        for (CountT i = 0; i < consts::maxAgents; i++) {
+            int32_t key = keys[w].key[i];
+            if (key >= 0) {
+                offsets[key + 1] += 1;
+            }
+        }
+    }
+
+    for (CountT g = 0; g < num_groups; g++) {
+        offsets[g + 1] += offsets[g];
+    }
+
+    CountT num_grouped = offsets[num_groups];
+    CountT num_agent_slots = num_worlds * consts::maxAgents;
+    for (CountT i = num_grouped; i < num_agent_slots; i++) {
+        permutation[i] = 0;
+    }
+
+    // offsets[g] is reused as group g's write cursor and restored after.
+    for (CountT w = 0; w < num_worlds; w++) {
+        int32_t row_base = row_bases[w];
+
+        for (CountT i = 0; i < consts::maxAgents; i++) {
+            int32_t key = keys[w].key[i];
+            if (key >= 0) {
+                permutation[offsets[key]++] = row_base + keys[w].row[i];
+            }
+        }
+    }
+
+    for (CountT g = num_groups; g > 0; g--) {
+        offsets[g] = offsets[g - 1];
+    }
+    offsets[0] = 0;
+}
+
+// Frozen policy file layout, all little endian:
+//   char magic[4] = "HSMP"
+//   uint32_t num_layers
+//   uint32_t dims[num_layers + 1]
+//   per layer i: float weights[dims[i + 1]][dims[i]], float biases[dims[i + 1]]
+// dims[0] must be frozenPolicyNumInputs and dims[num_layers]
+// frozenPolicyNumOutputs.
+template <typename Fn>
+static MLPWeights loadFrozenPolicy(const char *path, Fn &&upload_fn)
+{
+    MLPWeights mlp {};
+    if (path == nullptr) {
+        return mlp;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        FATAL("Failed to open frozen policy %s", path);
+    }
+
+    char magic[4];
+    uint32_t num_layers;
+    file.read(magic, sizeof(magic));
+    file.read((char *)&num_layers, sizeof(uint32_t));
+
+    if (!file || memcmp(magic, "HSMP", 4) != 0 || num_layers == 0 ||
+            num_layers > MLPWeights::maxLayers) {
+        FATAL("%s is not a valid frozen policy", path);
+    }
+
+    std::array<uint32_t, MLPWeights::maxLayers + 1> dims;
+    file.read((char *)dims.data(), sizeof(uint32_t) * (num_layers + 1));
+
+    if (!file || dims[0] != frozenPolicyNumInputs ||
+            dims[num_layers] != frozenPolicyNumOutputs) {
+        FATAL("Frozen policy %s doesn't match the observation / action "
+              "sizes", path);
+    }
+
+    size_t num_params = 0;
+    for (uint32_t i = 0; i < num_layers; i++) {
+        if (dims[i + 1] == 0 || dims[i + 1] > MLPWeights::maxWidth) {
+            FATAL("Frozen policy %s has a layer wider than %d", path,
+                  MLPWeights::maxWidth);
+        }
+
+        num_params += size_t(dims[i]) * dims[i + 1] + dims[i + 1];
+    }
+
+    HeapArray<float> params(num_params);
+    file.read((char *)params.data(), sizeof(float) * num_params);
+
+    if (!file) {
+        FATAL("Frozen policy %s is truncated", path);
+    }
+
+    mlp.params = (const float *)upload_fn(params.data(),
+                                          sizeof(float) * num_params);
+    mlp.numLayers = (int32_t)num_layers;
+    for (uint32_t i = 0; i <= num_layers; i++) {
+        mlp.dims[i] = (int32_t)dims[i];
+    }
+
+    return mlp;
+}
+
+// Reverse GAE scan over [num_steps, num_agents] arrays. The inner loop runs
+// across agents with no branches so it vectorizes; a done or an empty slot
+// cuts the recursion for that agent.
+static void computeGAE(CountT num_steps, CountT num_agents,
+                       float gamma, float gae_lambda,
+                       const float *rewards, const uint8_t *dones,
+                       const float *masks, const float *values,
+                       float *advantages, float *returns)
+{
+    HeapArray<float> last_adv(num_agents);
+    for (CountT i = 0; i < num_agents; i++) {
+        last_adv[i] = 0.f;
+    }
+
+    for (CountT t = num_steps - 1; t >= 0; t--) {
+        const CountT base = t * num_agents;
+        const float *cur_values = values + base;
+        const float *next_values = values + base + num_agents;
+
+        for (CountT i = 0; i < num_agents; i++) {
+            float not_done = 1.f - float(dones[base + i]);
+            float mask = masks[base + i];
+
+            float delta = rewards[base + i] +
+                gamma * not_done * next_values[i] - cur_values[i];
+            float adv = mask *
+                (delta + gamma * gae_lambda * not_done * last_adv[i]);
+
+            last_adv[i] = adv;
+            advantages[base + i] = adv;
+            returns[base + i] = adv + mask * cur_values[i];
+        }
+    }
+}
+
+Manager::Impl::~Impl()
+{
+    ExecMode exec_mode = cfg.execMode;
+
+    freeBuffer(exec_mode, rewardsBuffer);
+    freeBuffer(exec_mode, donesBuffer);
+
+    freeBuffer(exec_mode, rollout.curStep);
+    freeAgentBuffers(exec_mode, rollout.agents);
+    freeBuffer(exec_mode, rolloutValues);
+    freeBuffer(exec_mode, rolloutAdvantages);
+    freeBuffer(exec_mode, rolloutReturns);
+
+    freeAgentBuffers(exec_mode, team.agents);
+
+    freeBuffer(exec_mode, frozenPolicy.params);
+
+    // Only the CPU backend traces its own depth, into a malloc'd buffer.
+    free(depthBuffer);
+
+    freeBuffer(exec_mode, policyPermutation);
+    freeBuffer(exec_mode, policyOffsets);
+}
+
 Manager::Impl * Manager::Impl::init(
     const Config &cfg,
     const viz::VizECSBridge *viz_bridge,
@@ -210,10 +581,28 @@ Manager::Impl * Manager::Impl::init(
         FATAL("Failed to load render assets: %s", import_err);
     }
 
+    // Opt in: CPU worlds ray trace their own depth observations into a
+    // Manager owned buffer instead of using the batch renderer.
+    bool cpu_depth = cfg.cpuDepthRender;
+    if (cpu_depth && (cfg.execMode != ExecMode::CPU ||
+            batch_render_bridge != nullptr ||
+            cfg.renderWidth == 0 || cfg.renderHeight == 0)) {
+        FATAL("cpuDepthRender needs the CPU backend, no batch renderer "
+              "and a non-zero render size");
+    }
+
     GPUHideSeek::Config app_cfg {
         batch_render_bridge != nullptr,
         viz_bridge != nullptr,
         cfg.autoReset,
+        cfg.enableStateHash,
+        cpu_depth,
+        cfg.rolloutLength > 0,
+        cfg.scriptedPolicies,
+        cfg.frozenPolicyPath != nullptr,
+        cfg.frozenPolicyHiders,
+        (int32_t)cfg.numPolicies,
+        cfg.teamMajorLayout,
     };
 
     switch (cfg.execMode) {
@@ -221,10 +610,6 @@ Manager::Impl * Manager::Impl::init(
 #ifdef MADRONA_CUDA_SUPPORT
         CUcontext cu_ctx = MWCudaExecutor::initCUDA(cfg.gpuID);
 
-        EpisodeManager *episode_mgr = 
-            (EpisodeManager *)cu::allocGPU(sizeof(EpisodeManager));
-        REQ_CUDA(cudaMemset(episode_mgr, 0, sizeof(EpisodeManager)));
-
         PhysicsLoader phys_loader(cfg.execMode, 10);
         loadPhysicsObjects(phys_loader);
 
@@ -236,11 +621,34 @@ Manager::Impl * Manager::Impl::init(
         auto reward_buffer = (float *)cu::allocGPU(sizeof(float) *
             consts::maxAgents * cfg.numWorlds);
 
+        auto allocGPU = [](size_t num_bytes) {
+            return cu::allocGPU(num_bytes);
+        };
+
+        RolloutBuffers rollout = allocRolloutBuffers(cfg, allocGPU);
+
+        float *rollout_values, *rollout_advantages, *rollout_returns;
+        allocRolloutTargets(cfg, allocGPU, &rollout_values,
+                            &rollout_advantages, &rollout_returns);
+
+        TeamBuffers team = allocTeamBuffers(cfg, allocGPU,
+            [](void *dst, const void *src, size_t num_bytes) {
+                cudaMemcpy(dst, src, num_bytes, cudaMemcpyHostToDevice);
+            });
+
+        PolicyGroupBuffers policy_groups = allocPolicyGroupBuffers(cfg);
+
+        MLPWeights frozen_policy = loadFrozenPolicy(cfg.frozenPolicyPath,
+            [](const void *data, size_t num_bytes) {
+                void *dev_ptr = cu::allocGPU(num_bytes);
+                cudaMemcpy(dev_ptr, data, num_bytes, cudaMemcpyHostToDevice);
+                return dev_ptr;
+            });
+
         HeapArray<WorldInit> world_inits(cfg.numWorlds);
 
         for (int64_t i = 0; i < (int64_t)cfg.numWorlds; i++) {
             world_inits[i] = WorldInit {
-                episode_mgr,
                 reward_buffer,
                 done_buffer,
                 phys_obj_mgr,
@@ -248,9 +656,22 @@ Manager::Impl * Manager::Impl::init(
                 1,
                 viz_bridge,
                 batch_render_bridge,
+                nullptr,
+                0,
+                0,
+                rollout,
+                frozen_policy,
+                team,
             };
         }
 
+        const char *base_compile_flags[] = { GPU_HIDESEEK_COMPILE_FLAGS };
+        std::vector<const char *> compile_flags(std::begin(base_compile_flags),
+                                                std::end(base_compile_flags));
+#ifdef GPU_HIDESEEK_VALIDATE_YAW
+        compile_flags.push_back("-DGPU_HIDESEEK_VALIDATE_YAW=1");
+#endif
+
         MWCudaExecutor mwgpu_exec({
             .worldInitPtr = world_inits.data(),
             .numWorldInitBytes = sizeof(WorldInit),
@@ -259,10 +680,11 @@ Manager::Impl * Manager::Impl::init(
             .numWorldDataBytes = sizeof(Sim),
             .worldDataAlignment = alignof(Sim),
             .numWorlds = cfg.numWorlds,
-            .numExportedBuffers = 16,
+            .numExportedBuffers = 21,
         }, {
             { GPU_HIDESEEK_SRC_LIST },
-            { GPU_HIDESEEK_COMPILE_FLAGS },
+            Span<const char * const>(compile_flags.data(),
+                                     compile_flags.size()),
             cfg.debugCompile ? CompileConfig::OptMode::Debug :
                 CompileConfig::OptMode::LTO,
         }, cu_ctx);
@@ -270,19 +692,40 @@ Manager::Impl * Manager::Impl::init(
         WorldReset *world_reset_buffer = 
             (WorldReset *)mwgpu_exec.getExported(0);
 
+        WorldSeed *world_seed_buffer =
+            (WorldSeed *)mwgpu_exec.getExported(1);
+
         Action *agent_actions_buffer = 
             (Action *)mwgpu_exec.getExported(3);
 
+        CompletedEpisodeStats *episode_stats_buffer =
+            (CompletedEpisodeStats *)mwgpu_exec.getExported(17);
+
+        PolicyGroupKeys *policy_keys_buffer =
+            (PolicyGroupKeys *)mwgpu_exec.getExported(20);
+
         HostEventLogging(HostEvent::initEnd);
         return new CUDAImpl {
             { 
                 cfg,
                 std::move(phys_loader),
-                episode_mgr,
                 world_reset_buffer,
+                world_seed_buffer,
                 agent_actions_buffer,
+                episode_stats_buffer,
+                policy_keys_buffer,
                 reward_buffer,
                 done_buffer,
+                nullptr,
+                rollout,
+                0,
+                rollout_values,
+                rollout_advantages,
+                rollout_returns,
+                team,
+                frozen_policy,
+                policy_groups.permutation,
+                policy_groups.offsets,
             },
             std::move(mwgpu_exec),
         };
@@ -291,8 +734,6 @@ Manager::Impl * Manager::Impl::init(
 #endif
     } break;
     case ExecMode::CPU: {
-        EpisodeManager *episode_mgr = new EpisodeManager { 0 };
-
         PhysicsLoader phys_loader(cfg.execMode, 10);
         loadPhysicsObjects(phys_loader);
 
@@ -304,24 +745,66 @@ Manager::Impl * Manager::Impl::init(
         auto done_buffer = (uint8_t *)malloc(
             sizeof(uint8_t) * consts::maxAgents * cfg.numWorlds);
 
+        CountT num_depth_pixels =
+            CountT(cfg.renderWidth) * CountT(cfg.renderHeight);
+        float *depth_buffer = nullptr;
+        if (cpu_depth) {
+            depth_buffer = (float *)malloc(sizeof(float) *
+                consts::maxAgents * cfg.numWorlds * num_depth_pixels);
+        }
+
+        // Unlike the reward and done buffers, worlds index the rollout
+        // arrays by world ID, so every world shares the same base pointers.
+        auto allocCPU = [](size_t num_bytes) {
+            return malloc(num_bytes);
+        };
+
+        RolloutBuffers rollout = allocRolloutBuffers(cfg, allocCPU);
+
+        float *rollout_values, *rollout_advantages, *rollout_returns;
+        allocRolloutTargets(cfg, allocCPU, &rollout_values,
+                            &rollout_advantages, &rollout_returns);
+
+        TeamBuffers team = allocTeamBuffers(cfg, allocCPU,
+            [](void *dst, const void *src, size_t num_bytes) {
+                memcpy(dst, src, num_bytes);
+            });
+
+        PolicyGroupBuffers policy_groups = allocPolicyGroupBuffers(cfg);
+
+        MLPWeights frozen_policy = loadFrozenPolicy(cfg.frozenPolicyPath,
+            [](const void *data, size_t num_bytes) {
+                void *ptr = malloc(num_bytes);
+                memcpy(ptr, data, num_bytes);
+                return ptr;
+            });
+
         HeapArray<WorldInit> world_inits(cfg.numWorlds);
 
         for (int64_t i = 0; i < (int64_t)cfg.numWorlds; i++) {
             world_inits[i] = WorldInit {
-                episode_mgr,
                 reward_buffer + i * consts::maxAgents,
                 done_buffer + i * consts::maxAgents,
                 phys_obj_mgr,
                 0, 0,
                 viz_bridge,
                 batch_render_bridge,
+                cpu_depth ?
+                    depth_buffer + i * consts::maxAgents * num_depth_pixels :
+                    nullptr,
+                cfg.renderWidth,
+                cfg.renderHeight,
+                rollout,
+                frozen_policy,
+                team,
             };
         }
 
         CPUImpl::TaskGraphT cpu_exec {
             ThreadPoolExecutor::Config {
                 .numWorlds = cfg.numWorlds,
-                .numExportedBuffers = 16,
+                .numExportedBuffers = 21,
+                .numWorkers = cfg.numWorkers,
             },
             app_cfg,
             world_inits.data(),
@@ -330,18 +813,39 @@ Manager::Impl * Manager::Impl::init(
         WorldReset *world_reset_buffer =
             (WorldReset *)cpu_exec.getExported(0);
 
+        WorldSeed *world_seed_buffer =
+            (WorldSeed *)cpu_exec.getExported(1);
+
         Action *agent_actions_buffer = 
             (Action *)cpu_exec.getExported(3);
 
+        CompletedEpisodeStats *episode_stats_buffer =
+            (CompletedEpisodeStats *)cpu_exec.getExported(17);
+
+        PolicyGroupKeys *policy_keys_buffer =
+            (PolicyGroupKeys *)cpu_exec.getExported(20);
+
         auto cpu_impl = new CPUImpl {
             { 
                 cfg,
                 std::move(phys_loader),
-                episode_mgr,
                 world_reset_buffer,
+                world_seed_buffer,
                 agent_actions_buffer,
+                episode_stats_buffer,
+                policy_keys_buffer,
                 reward_buffer,
                 done_buffer,
+                depth_buffer,
+                rollout,
+                0,
+                rollout_values,
+                rollout_advantages,
+                rollout_returns,
+                team,
+                frozen_policy,
+                policy_groups.permutation,
+                policy_groups.offsets,
             },
             std::move(cpu_exec),
         };
@@ -364,6 +868,9 @@ Manager::Manager(
         triggerReset(i, 1, 3, 2);
     }
 
+    // The initial step only produces the first observations, so it isn't
+    // recorded.
+    impl_->numRolloutSteps = -1;
     step();
 }
 
@@ -385,6 +892,25 @@ Manager::~Manager() {
 
 void Manager::step()
 {
+    if (impl_->rollout.curStep != nullptr) {
+        int32_t cur_step = -1;
+        if (impl_->numRolloutSteps >= 0) {
+            cur_step =
+                int32_t(impl_->numRolloutSteps % impl_->rollout.length);
+        }
+
+        if (impl_->cfg.execMode == ExecMode::CUDA) {
+#ifdef MADRONA_CUDA_SUPPORT
+            cudaMemcpy(impl_->rollout.curStep, &cur_step, sizeof(int32_t),
+                       cudaMemcpyHostToDevice);
+#endif
+        } else {
+            *impl_->rollout.curStep = cur_step;
+        }
+    }
+
+    impl_->numRolloutSteps++;
+
     switch (impl_->cfg.execMode) {
     case ExecMode::CUDA: {
 #ifdef MADRONA_CUDA_SUPPORT
@@ -399,6 +925,9 @@ void Manager::step()
         CountT cur_agent_offset = 0;
         float *base_rewards = cpu_impl->rewardsBuffer;
         uint8_t *base_dones = cpu_impl->donesBuffer;
+        float *base_depth = cpu_impl->depthBuffer;
+        CountT num_depth_pixels =
+            CountT(impl_->cfg.renderWidth) * CountT(impl_->cfg.renderHeight);
 
         for (CountT i = 0; i < (CountT)impl_->cfg.numWorlds; i++) {
             const Sim &sim_data = cpu_impl->cpuExec.getWorldData(i);
@@ -414,12 +943,53 @@ void Manager::step()
                     world_dones,
                     sizeof(uint8_t) * num_agents);
 
+            if (base_depth != nullptr) {
+                memmove(&base_depth[cur_agent_offset * num_depth_pixels],
+                        sim_data.depthBuffer,
+                        sizeof(float) * num_agents * num_depth_pixels);
+            }
+
             cur_agent_offset += num_agents;
         }
     } break;
     }
+
+    if (impl_->cfg.numPolicies > 0) {
+        updatePolicyGroups();
+    }
+}
+
+void Manager::updatePolicyGroups()
+{
+    const CountT num_worlds = impl_->cfg.numWorlds;
+    const CountT num_groups = 2 * CountT(impl_->cfg.numPolicies);
+
+    // Exported columns are packed world after world, so each world's rows
+    // start after every earlier world's agents.
+    auto cpu_impl = static_cast<CPUImpl *>(impl_);
+    HeapArray<int32_t> row_bases(num_worlds);
+
+    int32_t cur_row_base = 0;
+    for (CountT i = 0; i < num_worlds; i++) {
+        row_bases[i] = cur_row_base;
+        cur_row_base +=
+            (int32_t)cpu_impl->cpuExec.getWorldData(i).numActiveAgents;
+    }
+
+    sortPolicyGroups(impl_->policyKeysPointer, row_bases.data(),
+                     num_worlds, num_groups, impl_->policyPermutation,
+                     impl_->policyOffsets);
 }
 
+uint32_t Manager::numWorlds() const
+{
+    return impl_->cfg.numWorlds;
+}
+
+bool Manager::teamMajorLayout() const
+{
+    return impl_->cfg.teamMajorLayout;
+}
 
 Tensor Manager::resetTensor() const
 {
@@ -550,6 +1120,10 @@ Tensor Manager::depthTensor() const
     void *dev_ptr = nullptr;
     Optional<int> gpu_id = Optional<int>::none();
 
+    if (impl_->depthBuffer != nullptr) {
+        dev_ptr = impl_->depthBuffer;
+    }
+
 #if 0
     if (impl_->cfg.execMode == ExecMode::CUDA) {
 #ifdef MADRONA_CUDA_SUPPORT
@@ -615,13 +1189,316 @@ madrona::py::Tensor Manager::seedTensor() const
     return exportStateTensor(15, Tensor::ElementType::Int32,
                              {
                                  impl_->cfg.numWorlds * consts::maxAgents,
+                                 2,
+                             });
+}
+
+madrona::py::Tensor Manager::worldSeedTensor() const
+{
+    return exportStateTensor(1, Tensor::ElementType::Int32,
+                             {
+                                 impl_->cfg.numWorlds,
+                                 2,
+                             });
+}
+
+madrona::py::Tensor Manager::occupancyGridTensor() const
+{
+    return exportStateTensor(16, Tensor::ElementType::Int32,
+                             {
+                                 impl_->cfg.numWorlds * consts::maxAgents,
+                                 consts::occupancyGridSize,
+                             });
+}
+
+madrona::py::Tensor Manager::episodeStatsTensor() const
+{
+    return exportStateTensor(17, Tensor::ElementType::Float32,
+                             {
+                                 impl_->cfg.numWorlds,
+                                 1 + sizeof(EpisodeStats) / sizeof(float),
+                             });
+}
+
+madrona::py::Tensor Manager::scriptedAgentsTensor() const
+{
+    return exportStateTensor(18, Tensor::ElementType::Int32,
+                             {
+                                 impl_->cfg.numWorlds,
+                                 consts::maxAgents,
+                             });
+}
+
+madrona::py::Tensor Manager::policyAssignmentTensor() const
+{
+    return exportStateTensor(19, Tensor::ElementType::Int32,
+                             {
+                                 impl_->cfg.numWorlds,
+                                 2,
+                             });
+}
+
+Tensor Manager::policyPermutationTensor() const
+{
+    if (impl_->policyPermutation == nullptr) {
+        FATAL("Manager wasn't created with numPolicies > 0");
+    }
+
+    return Tensor(impl_->policyPermutation, Tensor::ElementType::Int32,
+                  {impl_->cfg.numWorlds * consts::maxAgents},
+                  Optional<int>::none());
+}
+
+Tensor Manager::policyOffsetsTensor() const
+{
+    if (impl_->policyOffsets == nullptr) {
+        FATAL("Manager wasn't created with numPolicies > 0");
+    }
+
+    return Tensor(impl_->policyOffsets, Tensor::ElementType::Int32,
+                  {2 * impl_->cfg.numPolicies + 1}, Optional<int>::none());
+}
+
+madrona::py::Tensor Manager::stateHashTensor() const
+{
+    return exportStateTensor(4, Tensor::ElementType::Int64,
+                             {
+                                 impl_->cfg.numWorlds,
                                  1,
                              });
 }
 
+Tensor Manager::teamPrepCounterTensor() const
+{
+    return teamTensor(impl_->team.agents.prepCounters,
+                      Tensor::ElementType::Int32, {1});
+}
+
+Tensor Manager::teamAgentTypeTensor() const
+{
+    return teamTensor(impl_->team.agents.agentTypes,
+                      Tensor::ElementType::Int32, {1});
+}
+
+Tensor Manager::teamAgentMaskTensor() const
+{
+    return teamTensor(impl_->team.agents.agentMasks,
+                      Tensor::ElementType::Float32, {1});
+}
+
+Tensor Manager::teamAgentDataTensor() const
+{
+    return teamTensor(impl_->team.agents.agentData,
+                      Tensor::ElementType::Float32,
+                      {consts::maxAgents - 1, 4});
+}
+
+Tensor Manager::teamBoxDataTensor() const
+{
+    return teamTensor(impl_->team.agents.boxData,
+                      Tensor::ElementType::Float32,
+                      {consts::maxBoxes, 7});
+}
+
+Tensor Manager::teamRampDataTensor() const
+{
+    return teamTensor(impl_->team.agents.rampData,
+                      Tensor::ElementType::Float32,
+                      {consts::maxRamps, 5});
+}
+
+Tensor Manager::teamVisibleAgentsMaskTensor() const
+{
+    return teamTensor(impl_->team.agents.visibleAgents,
+                      Tensor::ElementType::Float32,
+                      {consts::maxAgents - 1, 1});
+}
+
+Tensor Manager::teamVisibleBoxesMaskTensor() const
+{
+    return teamTensor(impl_->team.agents.visibleBoxes,
+                      Tensor::ElementType::Float32,
+                      {consts::maxBoxes, 1});
+}
+
+Tensor Manager::teamVisibleRampsMaskTensor() const
+{
+    return teamTensor(impl_->team.agents.visibleRamps,
+                      Tensor::ElementType::Float32,
+                      {consts::maxRamps, 1});
+}
+
+Tensor Manager::teamLidarTensor() const
+{
+    return teamTensor(impl_->team.agents.lidar,
+                      Tensor::ElementType::Float32, {30});
+}
+
+Tensor Manager::teamActionTensor() const
+{
+    return teamTensor(impl_->team.agents.actions,
+                      Tensor::ElementType::Int32, {5});
+}
+
+Tensor Manager::teamRewardTensor() const
+{
+    return teamTensor(impl_->team.agents.rewards,
+                      Tensor::ElementType::Float32, {1});
+}
+
+Tensor Manager::teamDoneTensor() const
+{
+    return teamTensor(impl_->team.agents.dones,
+                      Tensor::ElementType::UInt8, {1});
+}
+
+Tensor Manager::rolloutPrepCounterTensor() const
+{
+    return rolloutTensor(impl_->rollout.agents.prepCounters,
+                         Tensor::ElementType::Int32, {1});
+}
+
+Tensor Manager::rolloutAgentTypeTensor() const
+{
+    return rolloutTensor(impl_->rollout.agents.agentTypes,
+                         Tensor::ElementType::Int32, {1});
+}
+
+Tensor Manager::rolloutAgentMaskTensor() const
+{
+    return rolloutTensor(impl_->rollout.agents.agentMasks,
+                         Tensor::ElementType::Float32, {1});
+}
+
+Tensor Manager::rolloutAgentDataTensor() const
+{
+    return rolloutTensor(impl_->rollout.agents.agentData,
+                         Tensor::ElementType::Float32,
+                         {consts::maxAgents - 1, 4});
+}
+
+Tensor Manager::rolloutBoxDataTensor() const
+{
+    return rolloutTensor(impl_->rollout.agents.boxData,
+                         Tensor::ElementType::Float32,
+                         {consts::maxBoxes, 7});
+}
+
+Tensor Manager::rolloutRampDataTensor() const
+{
+    return rolloutTensor(impl_->rollout.agents.rampData,
+                         Tensor::ElementType::Float32,
+                         {consts::maxRamps, 5});
+}
+
+Tensor Manager::rolloutVisibleAgentsMaskTensor() const
+{
+    return rolloutTensor(impl_->rollout.agents.visibleAgents,
+                         Tensor::ElementType::Float32,
+                         {consts::maxAgents - 1, 1});
+}
+
+Tensor Manager::rolloutVisibleBoxesMaskTensor() const
+{
+    return rolloutTensor(impl_->rollout.agents.visibleBoxes,
+                         Tensor::ElementType::Float32,
+                         {consts::maxBoxes, 1});
+}
+
+Tensor Manager::rolloutVisibleRampsMaskTensor() const
+{
+    return rolloutTensor(impl_->rollout.agents.visibleRamps,
+                         Tensor::ElementType::Float32,
+                         {consts::maxRamps, 1});
+}
+
+Tensor Manager::rolloutLidarTensor() const
+{
+    return rolloutTensor(impl_->rollout.agents.lidar,
+                         Tensor::ElementType::Float32, {30});
+}
+
+Tensor Manager::rolloutActionTensor() const
+{
+    return rolloutTensor(impl_->rollout.agents.actions,
+                         Tensor::ElementType::Int32, {5});
+}
+
+Tensor Manager::rolloutRewardTensor() const
+{
+    return rolloutTensor(impl_->rollout.agents.rewards,
+                         Tensor::ElementType::Float32, {1});
+}
+
+Tensor Manager::rolloutDoneTensor() const
+{
+    return rolloutTensor(impl_->rollout.agents.dones,
+                         Tensor::ElementType::UInt8, {1});
+}
+
+int64_t Manager::rolloutStepsRecorded() const
+{
+    return impl_->numRolloutSteps;
+}
+
+Tensor Manager::rolloutValueTensor() const
+{
+    checkAdvantagesSupported(impl_->cfg);
+
+    return Tensor(impl_->rolloutValues, Tensor::ElementType::Float32,
+                  {
+                      impl_->rollout.length + 1,
+                      impl_->rollout.numAgentSlots,
+                      1,
+                  }, Optional<int>::none());
+}
+
+Tensor Manager::rolloutAdvantageTensor() const
+{
+    checkAdvantagesSupported(impl_->cfg);
+
+    return rolloutTensor(impl_->rolloutAdvantages,
+                         Tensor::ElementType::Float32, {1});
+}
+
+Tensor Manager::rolloutReturnTensor() const
+{
+    checkAdvantagesSupported(impl_->cfg);
+
+    return rolloutTensor(impl_->rolloutReturns,
+                         Tensor::ElementType::Float32, {1});
+}
+
+void Manager::computeAdvantages(float gamma, float gae_lambda)
+{
+    checkAdvantagesSupported(impl_->cfg);
+
+    // Row 0 only holds the oldest step of the rollout when the ring has
+    // just wrapped.
+    const RolloutBuffers &rollout = impl_->rollout;
+    if (impl_->numRolloutSteps <= 0 ||
+            impl_->numRolloutSteps % rollout.length != 0) {
+        FATAL("computeAdvantages needs a whole rollout: %ld steps recorded, "
+              "rollout length %d", (long)impl_->numRolloutSteps,
+              (int)rollout.length);
+    }
+
+    computeGAE(rollout.length, rollout.numAgentSlots, gamma, gae_lambda,
+               rollout.agents.rewards, rollout.agents.dones,
+               rollout.agents.agentMasks,
+               impl_->rolloutValues, impl_->rolloutAdvantages,
+               impl_->rolloutReturns);
+}
+
 void Manager::triggerReset(CountT world_idx, CountT level_idx,
                            CountT num_hiders, CountT num_seekers)
 {
+    if (num_hiders < 0 || num_hiders > consts::maxHiders ||
+            num_seekers < 0 || num_seekers > consts::maxSeekers) {
+        FATAL("Teams are limited to %d hiders and %d seekers",
+              consts::maxHiders, consts::maxSeekers);
+    }
+
     WorldReset reset {
         (int32_t)level_idx,
         (int32_t)num_hiders,
@@ -640,10 +1517,29 @@ void Manager::triggerReset(CountT world_idx, CountT level_idx,
     }
 }
 
+void Manager::setWorldSeed(CountT world_idx, uint32_t seed)
+{
+    auto *seed_ptr = impl_->seedsPointer + world_idx;
+
+    if (impl_->cfg.execMode == ExecMode::CUDA) {
+#ifdef MADRONA_CUDA_SUPPORT
+        cudaMemcpy(&seed_ptr->baseSeed, &seed, sizeof(uint32_t),
+                   cudaMemcpyHostToDevice);
+#endif
+    }  else {
+        seed_ptr->baseSeed = seed;
+    }
+}
+
 void Manager::setAction(CountT agent_idx,
                         int32_t x, int32_t y, int32_t r,
                         bool g, bool l)
 {
+    if (impl_->cfg.teamMajorLayout) {
+        FATAL("setAction is ignored with teamMajorLayout, "
+              "write teamActionTensor() instead");
+    }
+
     Action action { 
         .x = x,
         .y = y,
@@ -664,6 +1560,123 @@ void Manager::setAction(CountT agent_idx,
     }
 }
 
+void Manager::setActions(const int32_t *actions)
+{
+    if (impl_->cfg.teamMajorLayout) {
+        FATAL("setActions is ignored with teamMajorLayout, "
+              "use setTeamActions() instead");
+    }
+
+    size_t num_bytes =
+        sizeof(Action) * size_t(impl_->cfg.numWorlds) * consts::maxAgents;
+
+    if (impl_->cfg.execMode == ExecMode::CUDA) {
+#ifdef MADRONA_CUDA_SUPPORT
+        cudaMemcpy(impl_->actionsPointer, actions, num_bytes,
+                   cudaMemcpyHostToDevice);
+#endif
+    } else {
+        memcpy(impl_->actionsPointer, actions, num_bytes);
+    }
+}
+
+void Manager::setTeamActions(const int32_t *actions)
+{
+    if (!impl_->cfg.teamMajorLayout) {
+        FATAL("Manager wasn't created with teamMajorLayout");
+    }
+
+    size_t num_bytes =
+        sizeof(Action) * size_t(impl_->cfg.numWorlds) * consts::maxAgents;
+
+    if (impl_->cfg.execMode == ExecMode::CUDA) {
+#ifdef MADRONA_CUDA_SUPPORT
+        cudaMemcpy(impl_->team.agents.actions, actions, num_bytes,
+                   cudaMemcpyHostToDevice);
+#endif
+    } else {
+        memcpy(impl_->team.agents.actions, actions, num_bytes);
+    }
+}
+
+Manager::EvaluationResult Manager::runEvaluation(
+    CountT num_episodes,
+    CountT num_hiders,
+    CountT num_seekers,
+    const EvalActionFn &set_actions)
+{
+    const CountT num_worlds = impl_->cfg.numWorlds;
+
+    // Start every world on a fresh episode. The step that applies the reset
+    // publishes whatever partial episode was running, which is skipped.
+    for (CountT i = 0; i < num_worlds; i++) {
+        triggerReset(i, 1, num_hiders, num_seekers);
+    }
+    step();
+
+    HeapArray<CompletedEpisodeStats> world_stats(num_worlds);
+
+    EvaluationResult result {};
+    int64_t num_hider_wins = 0;
+
+    for (CountT episode_idx = 0; episode_idx < num_episodes; episode_idx++) {
+        for (CountT t = 0; t < consts::episodeLen; t++) {
+            // Resetting on the last step ends every episode at the same
+            // length whether or not autoReset is enabled.
+            if (t == consts::episodeLen - 1) {
+                for (CountT i = 0; i < num_worlds; i++) {
+                    triggerReset(i, 1, num_hiders, num_seekers);
+                }
+            }
+
+            if (set_actions) {
+                set_actions(t);
+            }
+
+            step();
+        }
+
+        if (impl_->cfg.execMode == ExecMode::CUDA) {
+#ifdef MADRONA_CUDA_SUPPORT
+            cudaMemcpy(world_stats.data(), impl_->episodeStatsPointer,
+                       sizeof(CompletedEpisodeStats) * num_worlds,
+                       cudaMemcpyDeviceToHost);
+#endif
+        } else {
+            memcpy(world_stats.data(), impl_->episodeStatsPointer,
+                   sizeof(CompletedEpisodeStats) * num_worlds);
+        }
+
+        for (CountT i = 0; i < num_worlds; i++) {
+            const EpisodeStats &stats = world_stats[i].stats;
+
+            if (stats.hiderTeamReturn > 0.f) {
+                num_hider_wins += 1;
+            }
+
+            result.meanHiderTeamReturn += stats.hiderTeamReturn;
+            result.meanHiderSeenSteps += stats.numHiderSeenSteps;
+            result.meanGrabs += stats.numGrabs;
+            result.meanLocks += stats.numLocks;
+            result.meanOutOfBounds += stats.numOutOfBounds;
+        }
+    }
+
+    result.numEpisodes = int64_t(num_episodes) * int64_t(num_worlds);
+
+    if (result.numEpisodes > 0) {
+        float inv_num_episodes = 1.f / float(result.numEpisodes);
+        result.hiderWinRate = float(num_hider_wins) * inv_num_episodes;
+        result.meanHiderTeamReturn *= inv_num_episodes;
+        result.meanHiderSeenSteps *= inv_num_episodes;
+        result.meanGrabs *= inv_num_episodes;
+        result.meanLocks *= inv_num_episodes;
+        result.meanOutOfBounds *= inv_num_episodes;
+    }
+
+    return result;
+}
+
 Tensor Manager::exportStateTensor(int64_t slot,
                                   Tensor::ElementType type,
                                   Span<const int64_t> dimensions) const
@@ -683,5 +1696,51 @@ Tensor Manager::exportStateTensor(int64_t slot,
     return Tensor(dev_ptr, type, dimensions, gpu_id);
 }
 
+Tensor Manager::rolloutTensor(void *dev_ptr,
+                              Tensor::ElementType type,
+                              Span<const int64_t> inner_dims) const
+{
+    if (dev_ptr == nullptr) {
+        FATAL("Manager wasn't created with a rollout buffer");
+    }
+
+    Optional<int> gpu_id = Optional<int>::none();
+    if (impl_->cfg.execMode == ExecMode::CUDA) {
+        gpu_id = impl_->cfg.gpuID;
+    }
+
+    std::array<int64_t, 4> dims;
+    dims[0] = impl_->rollout.length;
+    dims[1] = impl_->rollout.numAgentSlots;
+    for (CountT i = 0; i < inner_dims.size(); i++) {
+        dims[2 + i] = inner_dims[i];
+    }
+
+    return Tensor(dev_ptr, type,
+        Span<const int64_t>(dims.data(), 2 + inner_dims.size()), gpu_id);
+}
+
+Tensor Manager::teamTensor(void *dev_ptr,
+                           Tensor::ElementType type,
+                           Span<const int64_t> inner_dims) const
+{
+    if (dev_ptr == nullptr) {
+        FATAL("Manager wasn't created with teamMajorLayout");
+    }
+
+    Optional<int> gpu_id = Optional<int>::none();
+    if (impl_->cfg.execMode == ExecMode::CUDA) {
+        gpu_id = impl_->cfg.gpuID;
+    }
+
+    std::array<int64_t, 3> dims;
+    dims[0] = impl_->team.numWorlds * consts::maxAgents;
+    for (CountT i = 0; i < inner_dims.size(); i++) {
+        dims[1 + i] = inner_dims[i];
+    }
+
+    return Tensor(dev_ptr, type,
+        Span<const int64_t>(dims.data(), 1 + inner_dims.size()), gpu_id);
+}
 
 }
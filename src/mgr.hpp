@@ -5,6 +5,7 @@
 #define MGR_EXPORT MADRONA_IMPORT
 #endif
 
+#include <functional>
 #include <memory>
 
 #include <madrona/py/utils.hpp>
@@ -24,9 +25,35 @@ public:
         uint32_t renderHeight;
         bool autoReset;
         bool enableBatchRender;
+        bool cpuDepthRender; // CPU only, ray traced depthTensor()
         bool debugCompile;
+        bool enableStateHash;
+        uint32_t numWorkers; // CPU only, 0 uses every core
+        uint32_t rolloutLength; // 0 disables the rollout buffer
+        bool scriptedPolicies;
+        const char *frozenPolicyPath; // MLP weights, nullptr disables
+        bool frozenPolicyHiders; // frozen team, false for the seekers
+        uint32_t numPolicies; // CPU only, 0 disables policy grouping
+        bool teamMajorLayout; // team*Tensor() mirror, sole action input
     };
 
+    // Averages over every episode played by runEvaluation(). An episode
+    // counts as a hider win when the hider team return is positive.
+    struct EvaluationResult {
+        int64_t numEpisodes;
+        float hiderWinRate;
+        float meanHiderTeamReturn;
+        float meanHiderSeenSteps;
+        float meanGrabs;
+        float meanLocks;
+        float meanOutOfBounds;
+    };
+
+    // Called before each evaluation step with the step index within the
+    // current episode; expected to fill in every agent's action, through
+    // setTeamActions() with teamMajorLayout.
+    using EvalActionFn = std::function<void(int64_t episode_step)>;
+
     MGR_EXPORT Manager(const Config &cfg,
         const madrona::viz::VizECSBridge *viz_bridge = nullptr,
         const madrona::render::BatchRendererECSBridge *batch_render_bridge =
@@ -35,6 +62,9 @@ public:
 
     MGR_EXPORT void step();
 
+    MGR_EXPORT uint32_t numWorlds() const;
+    MGR_EXPORT bool teamMajorLayout() const;
+
     MGR_EXPORT madrona::py::Tensor resetTensor() const;
     MGR_EXPORT madrona::py::Tensor doneTensor() const;
     MGR_EXPORT madrona::py::Tensor prepCounterTensor() const;
@@ -52,25 +82,121 @@ public:
     MGR_EXPORT madrona::py::Tensor depthTensor() const;
     MGR_EXPORT madrona::py::Tensor rgbTensor() const;
     MGR_EXPORT madrona::py::Tensor lidarTensor() const;
+    // Per agent [worldSeed, episodeIdx] of the episode it is in.
     MGR_EXPORT madrona::py::Tensor seedTensor() const;
+    MGR_EXPORT madrona::py::Tensor worldSeedTensor() const;
+    MGR_EXPORT madrona::py::Tensor stateHashTensor() const;
+    MGR_EXPORT madrona::py::Tensor occupancyGridTensor() const;
+    MGR_EXPORT madrona::py::Tensor episodeStatsTensor() const;
+    MGR_EXPORT madrona::py::Tensor scriptedAgentsTensor() const;
+
+    // Per world [hiderPolicy, seekerPolicy] input. After every step,
+    // policyPermutationTensor() lists the rows of the AgentInterface
+    // tensors (observations, actions, ...) grouped by (team, policy):
+    // hiders under policy 0 .. numPolicies - 1, then seekers likewise.
+    // Group g is permutation[offsets[g]:offsets[g + 1]], and entries past
+    // offsets[2 * numPolicies] are 0. Grouping is sorted on the host, so
+    // it's CPU backend only.
+    MGR_EXPORT madrona::py::Tensor policyAssignmentTensor() const;
+    MGR_EXPORT madrona::py::Tensor policyPermutationTensor() const;
+    MGR_EXPORT madrona::py::Tensor policyOffsetsTensor() const;
+
+    // Team-major mirror of the agent tensors, [2 * numWorlds * 3, ...]:
+    // hider k of world w is row w * 3 + k and seeker k is row
+    // numWorlds * 3 + w * 3 + k, so each team is a contiguous half. Rows
+    // without an agent are zeroed. Actions written to teamActionTensor()
+    // drive the agents on the next step() and are consumed by it. With this
+    // layout enabled, teamActionTensor() is the only action input: writes
+    // to actionTensor() are overwritten, and setAction() and setActions()
+    // are rejected in favor of setTeamActions().
+    MGR_EXPORT madrona::py::Tensor teamPrepCounterTensor() const;
+    MGR_EXPORT madrona::py::Tensor teamAgentTypeTensor() const;
+    MGR_EXPORT madrona::py::Tensor teamAgentMaskTensor() const;
+    MGR_EXPORT madrona::py::Tensor teamAgentDataTensor() const;
+    MGR_EXPORT madrona::py::Tensor teamBoxDataTensor() const;
+    MGR_EXPORT madrona::py::Tensor teamRampDataTensor() const;
+    MGR_EXPORT madrona::py::Tensor teamVisibleAgentsMaskTensor() const;
+    MGR_EXPORT madrona::py::Tensor teamVisibleBoxesMaskTensor() const;
+    MGR_EXPORT madrona::py::Tensor teamVisibleRampsMaskTensor() const;
+    MGR_EXPORT madrona::py::Tensor teamLidarTensor() const;
+    MGR_EXPORT madrona::py::Tensor teamActionTensor() const;
+    MGR_EXPORT madrona::py::Tensor teamRewardTensor() const;
+    MGR_EXPORT madrona::py::Tensor teamDoneTensor() const;
+
+    // Rollout buffer, [rolloutLength, numWorlds * maxAgents, ...]. Step t
+    // lands in row t % rolloutLength, so the ring holds one whole rollout
+    // every time rolloutStepsRecorded() is a multiple of rolloutLength.
+    MGR_EXPORT madrona::py::Tensor rolloutPrepCounterTensor() const;
+    MGR_EXPORT madrona::py::Tensor rolloutAgentTypeTensor() const;
+    MGR_EXPORT madrona::py::Tensor rolloutAgentMaskTensor() const;
+    MGR_EXPORT madrona::py::Tensor rolloutAgentDataTensor() const;
+    MGR_EXPORT madrona::py::Tensor rolloutBoxDataTensor() const;
+    MGR_EXPORT madrona::py::Tensor rolloutRampDataTensor() const;
+    MGR_EXPORT madrona::py::Tensor rolloutVisibleAgentsMaskTensor() const;
+    MGR_EXPORT madrona::py::Tensor rolloutVisibleBoxesMaskTensor() const;
+    MGR_EXPORT madrona::py::Tensor rolloutVisibleRampsMaskTensor() const;
+    MGR_EXPORT madrona::py::Tensor rolloutLidarTensor() const;
+    MGR_EXPORT madrona::py::Tensor rolloutActionTensor() const;
+    MGR_EXPORT madrona::py::Tensor rolloutRewardTensor() const;
+    MGR_EXPORT madrona::py::Tensor rolloutDoneTensor() const;
+    MGR_EXPORT int64_t rolloutStepsRecorded() const;
+
+    // Value estimates for the rollout, [rolloutLength + 1, numWorlds *
+    // maxAgents, 1]: one row per recorded step plus a bootstrap row for the
+    // observations after the last step. Filled by the trainer. These and
+    // computeAdvantages() are CPU backend only; CUDA trainers should scan
+    // the rollout tensors on the device instead.
+    MGR_EXPORT madrona::py::Tensor rolloutValueTensor() const;
+    MGR_EXPORT madrona::py::Tensor rolloutAdvantageTensor() const;
+    MGR_EXPORT madrona::py::Tensor rolloutReturnTensor() const;
+
+    // Computes GAE advantages and discounted returns over a full rollout
+    // from the recorded rewards, dones and agent masks and the values in
+    // rolloutValueTensor(). rolloutStepsRecorded() must be a non-zero
+    // multiple of rolloutLength.
+    MGR_EXPORT void computeAdvantages(float gamma, float gae_lambda);
 
     MGR_EXPORT void triggerReset(madrona::CountT world_idx,
                                  madrona::CountT level_idx,
                                  madrona::CountT num_hiders,
                                  madrona::CountT num_seekers);
+    MGR_EXPORT void setWorldSeed(madrona::CountT world_idx, uint32_t seed);
     MGR_EXPORT void setAction(madrona::CountT agent_idx,
                               int32_t x, int32_t y, int32_t r,
                               bool g, bool l);
+    // Overwrites every agent's action from a host array in actionTensor()
+    // layout.
+    MGR_EXPORT void setActions(const int32_t *actions);
+    // Same as setActions(), in teamActionTensor() layout. Only valid with
+    // teamMajorLayout.
+    MGR_EXPORT void setTeamActions(const int32_t *actions);
+
+    // Resets every world and plays num_episodes full episodes in each of
+    // them without returning to the caller between steps.
+    MGR_EXPORT EvaluationResult runEvaluation(madrona::CountT num_episodes,
+                                              madrona::CountT num_hiders,
+                                              madrona::CountT num_seekers,
+                                              const EvalActionFn &set_actions);
 
 private:
     struct Impl;
     struct CPUImpl;
     struct CUDAImpl;
 
+    void updatePolicyGroups();
+
     inline madrona::py::Tensor exportStateTensor(int64_t slot,
         madrona::py::Tensor::ElementType type,
         madrona::Span<const int64_t> dimensions) const;
 
+    inline madrona::py::Tensor rolloutTensor(void *dev_ptr,
+        madrona::py::Tensor::ElementType type,
+        madrona::Span<const int64_t> inner_dims) const;
+
+    inline madrona::py::Tensor teamTensor(void *dev_ptr,
+        madrona::py::Tensor::ElementType type,
+        madrona::Span<const int64_t> inner_dims) const;
+
     Impl *impl_;
 };
 
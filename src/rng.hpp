@@ -4,12 +4,21 @@
 
 namespace GPUHideSeek {
 
+// Counter-based generator (Widynski's "Squares"). Every draw is a pure
+// function of (key, counter), so batches of draws are independent lanes.
 class RNG {
 public:
     static inline RNG make(uint32_t idx)
     {
-        uint32_t v0 = idx;
-        uint32_t v1 = 0;
+        return make(idx, 0);
+    }
+
+    // Mixes two words (e.g. a per-world seed and episode counter) into the
+    // key with 8 rounds of TEA.
+    static inline RNG make(uint32_t seed, uint32_t idx)
+    {
+        uint32_t v0 = seed;
+        uint32_t v1 = idx;
         uint32_t s0 = 0;
 
 #pragma unroll
@@ -22,31 +31,62 @@ public:
         }
 
         RNG rng;
-        rng.v_ = v0;
+        rng.key_ = ((uint64_t(v0) << 32) | uint64_t(v1)) | 1;
+        rng.ctr_ = 0;
 
         return rng;
     }
-    
+
     inline float rand()
     {
-        const uint32_t LCG_A = 1664525u;
-        const uint32_t LCG_C = 1013904223u;
-        v_ = (LCG_A * v_ + LCG_C);
+        return toFloat(squares(ctr_++, key_));
+    }
 
-        uint32_t next = v_ & 0x00FFFFFF;
-        return float(next) / float(0x01000000);
+    inline uint32_t u32Rand()
+    {
+        return squares(ctr_++, key_);
     }
 
-    inline uint32_t u32Rand() {
-        const uint32_t LCG_A = 1664525u;
-        const uint32_t LCG_C = 1013904223u;
-        v_ = (LCG_A * v_ + LCG_C);
+    // Fills out[0, n) with uniform floats in [0, 1). Each lane only depends
+    // on its own counter, so the loop has no serial dependency.
+    inline void rand(float *out, int32_t n)
+    {
+        uint64_t base = ctr_;
+
+        for (int32_t i = 0; i < n; i++) {
+            out[i] = toFloat(squares(base + uint64_t(i), key_));
+        }
 
-        return v_ & 0x00FFFFFF;
+        ctr_ = base + uint64_t(n);
     }
 
+    inline uint64_t key() const { return key_; }
+    inline uint64_t counter() const { return ctr_; }
+
 private:
-    uint32_t v_;
+    static inline uint32_t squares(uint64_t ctr, uint64_t key)
+    {
+        uint64_t x = ctr * key;
+        uint64_t y = x;
+        uint64_t z = y + key;
+
+        x = x * x + y;
+        x = (x >> 32) | (x << 32);
+        x = x * x + z;
+        x = (x >> 32) | (x << 32);
+        x = x * x + y;
+        x = (x >> 32) | (x << 32);
+
+        return uint32_t((x * x + z) >> 32);
+    }
+
+    static inline float toFloat(uint32_t v)
+    {
+        return float(v >> 8) / float(0x01000000);
+    }
+
+    uint64_t key_;
+    uint64_t ctr_;
 };
 
 }
@@ -3,6 +3,10 @@
 #include "sim.hpp"
 #include "level_gen.hpp"
 
+#ifdef GPU_HIDESEEK_VALIDATE_YAW
+#include <madrona/crash.hpp>
+#endif
+
 using namespace madrona;
 using namespace madrona::math;
 using namespace madrona::phys;
@@ -12,7 +16,17 @@ namespace GPUHideSeek {
 constexpr inline float deltaT = 1.f / 30.f;
 constexpr inline CountT numPhysicsSubsteps = 4;
 constexpr inline CountT numPrepSteps = 96;
-constexpr inline CountT episodeLen = 240;
+constexpr inline CountT episodeLen = consts::episodeLen;
+
+constexpr inline float sleepLinearSpeed = 0.1f;
+constexpr inline float sleepAngularSpeed = 0.1f;
+constexpr inline CountT numStepsToSleep = 15;
+constexpr inline float sleepWakeMargin = 0.5f;
+
+// Scripted agents keep acting on the last sighting of an opponent for this
+// many steps after losing sight of it.
+constexpr inline int32_t scriptedMemorySteps = 60;
+
 
 void Sim::registerTypes(ECSRegistry &registry,
                         const Config &)
@@ -28,6 +42,8 @@ void Sim::registerTypes(ECSRegistry &registry,
     registry.registerComponent<OwnerTeam>();
     registry.registerComponent<AgentType>();
     registry.registerComponent<GrabData>();
+    registry.registerComponent<Yaw>();
+    registry.registerComponent<SleepState>();
 
     registry.registerComponent<SimEntity>();
 
@@ -40,10 +56,22 @@ void Sim::registerTypes(ECSRegistry &registry,
     registry.registerComponent<RampVisibilityMasks>();
     registry.registerComponent<Lidar>();
     registry.registerComponent<Seed>();
+    registry.registerComponent<OccupancyGrid>();
+    registry.registerComponent<ScriptedMemory>();
 
 
     registry.registerSingleton<WorldReset>();
+    registry.registerSingleton<WorldSeed>();
     registry.registerSingleton<GlobalDebugPositions>();
+    registry.registerSingleton<WorldFrameObjects>();
+    registry.registerSingleton<StaticGeometry>();
+    registry.registerSingleton<StateHash>();
+    registry.registerSingleton<RolloutCursor>();
+    registry.registerSingleton<EpisodeStats>();
+    registry.registerSingleton<CompletedEpisodeStats>();
+    registry.registerSingleton<ScriptedAgents>();
+    registry.registerSingleton<PolicyAssignment>();
+    registry.registerSingleton<PolicyGroupKeys>();
 
     registry.registerArchetype<DynamicObject>();
     registry.registerArchetype<AgentInterface>();
@@ -51,6 +79,8 @@ void Sim::registerTypes(ECSRegistry &registry,
     registry.registerArchetype<DynAgent>();
 
     registry.exportSingleton<WorldReset>(0);
+    registry.exportSingleton<WorldSeed>(1);
+    registry.exportSingleton<StateHash>(4);
     registry.exportColumn<AgentInterface, AgentPrepCounter>(2);
     registry.exportColumn<AgentInterface, Action>(3);
     registry.exportColumn<AgentInterface, AgentType>(5);
@@ -63,7 +93,12 @@ void Sim::registerTypes(ECSRegistry &registry,
     registry.exportColumn<AgentInterface, RampVisibilityMasks>(12);
     registry.exportColumn<AgentInterface, Lidar>(14);
     registry.exportColumn<AgentInterface, Seed>(15);
+    registry.exportColumn<AgentInterface, OccupancyGrid>(16);
     registry.exportSingleton<GlobalDebugPositions>(13);
+    registry.exportSingleton<CompletedEpisodeStats>(17);
+    registry.exportSingleton<ScriptedAgents>(18);
+    registry.exportSingleton<PolicyAssignment>(19);
+    registry.exportSingleton<PolicyGroupKeys>(20);
 }
 
 static inline void resetEnvironment(Engine &ctx)
@@ -80,6 +115,8 @@ static inline void resetEnvironment(Engine &ctx)
 
     phys::RigidBodyPhysicsSystem::reset(ctx);
 
+    ctx.singleton<WorldFrameObjects>().staticCached = 0;
+
     Entity *all_entities = ctx.data().obstacles;
     for (CountT i = 0; i < ctx.data().numObstacles; i++) {
         Entity e = all_entities[i];
@@ -118,6 +155,25 @@ static inline void resetEnvironment(Engine &ctx)
     ctx.data().numActiveAgents = 0;
 }
 
+// Publishes the finished episode's totals. The placeholder episode generated
+// by the constructor, which the Manager's initial reset replaces, isn't
+// counted.
+static inline void finishEpisodeStats(Engine &ctx)
+{
+    EpisodeStats &stats = ctx.singleton<EpisodeStats>();
+
+    if (ctx.data().countEpisodeStats) {
+        stats.episodeLength = float(ctx.data().curEpisodeStep + 1);
+
+        CompletedEpisodeStats &completed =
+            ctx.singleton<CompletedEpisodeStats>();
+        completed.numEpisodes += 1.f;
+        completed.stats = stats;
+    }
+
+    stats = {};
+}
+
 inline void resetSystem(Engine &ctx, WorldReset &reset)
 {
     int32_t level = reset.resetLevel;
@@ -127,6 +183,7 @@ inline void resetSystem(Engine &ctx, WorldReset &reset)
     }
 
     if (level != 0) {
+        finishEpisodeStats(ctx);
         resetEnvironment(ctx);
 
         reset.resetLevel = 0;
@@ -135,6 +192,7 @@ inline void resetSystem(Engine &ctx, WorldReset &reset)
         int32_t num_seekers = reset.numSeekers;
 
         generateEnvironment(ctx, level, num_hiders, num_seekers);
+        ctx.data().countEpisodeStats = true;
     } else {
         ctx.data().curEpisodeStep += 1;
     }
@@ -204,6 +262,237 @@ inline void sortDebugSystem(Engine &ctx, WorldReset &)
 }
 #endif
 
+static inline void wakeObject(Engine &ctx, Entity e)
+{
+    auto sleep_state = ctx.getSafe<SleepState>(e);
+    if (!sleep_state.valid() || !sleep_state.value().asleep) {
+        return;
+    }
+
+    sleep_state.value() = {
+        .numQuietSteps = 0,
+        .asleep = 0,
+    };
+    ctx.get<ResponseType>(e) = ResponseType::Dynamic;
+}
+
+// Maps a direction in the agent's frame (x right, y forward) onto full speed
+// movement buckets, turning to face it.
+static inline void steerTowards(Vector3 local_dir, Action &action)
+{
+    float len = sqrtf(local_dir.x * local_dir.x + local_dir.y * local_dir.y);
+    if (len < 1e-3f) {
+        action.x = 5;
+        action.y = 5;
+        action.r = 5;
+        return;
+    }
+
+    action.x = 5 + int32_t(roundf(5.f * local_dir.x / len));
+    action.y = 5 + int32_t(roundf(5.f * local_dir.y / len));
+
+    // Positive torque turns counter-clockwise, i.e. towards -x.
+    float angle = atan2f(-local_dir.x, local_dir.y);
+    int32_t turn = int32_t(roundf(angle * (10.f / math::pi)));
+    action.r = 5 + std::min(std::max(turn, -5), 5);
+}
+
+// Heuristic opponents: seekers chase the nearest hider they can see (or last
+// saw), hiders run from the nearest seeker. Only agents in slots flagged in
+// ScriptedAgents are driven; everyone else keeps the trainer's actions.
+inline void scriptedPolicySystem(Engine &ctx,
+                                 Entity agent_e,
+                                 SimEntity sim_e,
+                                 AgentType agent_type,
+                                 const AgentVisibilityMasks &agent_vis,
+                                 ScriptedMemory &memory,
+                                 Action &action)
+{
+    if (sim_e.e == Entity::none() || agent_type == AgentType::Camera) {
+        return;
+    }
+
+    const ScriptedAgents &scripted = ctx.singleton<ScriptedAgents>();
+    CountT num_agents = ctx.data().numActiveAgents;
+
+    bool is_scripted = false;
+    for (CountT i = 0; i < num_agents; i++) {
+        if (ctx.data().agentInterfaces[i] == agent_e) {
+            is_scripted = scripted.scripted[i] != 0;
+            break;
+        }
+    }
+
+    if (!is_scripted) {
+        return;
+    }
+
+    AgentType opponent_type = agent_type == AgentType::Seeker ?
+        AgentType::Hider : AgentType::Seeker;
+
+    Vector3 agent_pos = ctx.get<Position>(sim_e.e);
+
+    // The visibility mask skips the agent's own slot.
+    bool seen = false;
+    Vector2 nearest_pos { 0, 0 };
+    float nearest_dist2 = 0.f;
+    CountT other_idx = 0;
+    for (CountT i = 0; i < num_agents; i++) {
+        Entity other_iface = ctx.data().agentInterfaces[i];
+        if (other_iface == agent_e) {
+            continue;
+        }
+
+        bool visible = agent_vis.visible[other_idx++] > 0.f;
+        if (!visible || ctx.get<AgentType>(other_iface) != opponent_type) {
+            continue;
+        }
+
+        Vector3 other_pos =
+            ctx.get<Position>(ctx.get<SimEntity>(other_iface).e);
+        float dx = other_pos.x - agent_pos.x;
+        float dy = other_pos.y - agent_pos.y;
+        float dist2 = dx * dx + dy * dy;
+
+        if (!seen || dist2 < nearest_dist2) {
+            seen = true;
+            nearest_dist2 = dist2;
+            nearest_pos = { other_pos.x, other_pos.y };
+        }
+    }
+
+    if (seen) {
+        memory.lastSeenPos = nearest_pos;
+        memory.stepsSinceSeen = 0;
+    } else if (memory.stepsSinceSeen >= 0 &&
+               ++memory.stepsSinceSeen > scriptedMemorySteps) {
+        memory.stepsSinceSeen = -1;
+    }
+
+    action.g = 0;
+    action.l = 0;
+
+    if (memory.stepsSinceSeen < 0) {
+        // Nothing to react to: seekers turn in place to scan, hiders wait.
+        action.x = 5;
+        action.y = 5;
+        action.r = agent_type == AgentType::Seeker ? 7 : 5;
+        return;
+    }
+
+    Vector3 to_target {
+        memory.lastSeenPos.x - agent_pos.x,
+        memory.lastSeenPos.y - agent_pos.y,
+        0.f,
+    };
+
+    if (agent_type == AgentType::Hider) {
+        to_target = -to_target;
+    }
+
+    Quat agent_rot = ctx.get<Rotation>(sim_e.e);
+    steerTowards(agent_rot.inv().rotateVec(to_target), action);
+}
+
+// y = max(W x + b, 0) (or without the ReLU) for a row-major [num_out, num_in]
+// W. Each dot product is split over four independent accumulators so the
+// inner loop vectorizes.
+static inline void denseLayer(const float *w, const float *b,
+                              const float *x, float *y,
+                              int32_t num_in, int32_t num_out, bool relu)
+{
+    for (int32_t o = 0; o < num_out; o++) {
+        const float *row = w + CountT(o) * num_in;
+
+        float acc0 = 0.f, acc1 = 0.f, acc2 = 0.f, acc3 = 0.f;
+        int32_t i = 0;
+        for (; i + 4 <= num_in; i += 4) {
+            acc0 += row[i] * x[i];
+            acc1 += row[i + 1] * x[i + 1];
+            acc2 += row[i + 2] * x[i + 2];
+            acc3 += row[i + 3] * x[i + 3];
+        }
+
+        float sum = b[o] + ((acc0 + acc1) + (acc2 + acc3));
+        for (; i < num_in; i++) {
+            sum += row[i] * x[i];
+        }
+
+        y[o] = relu ? fmaxf(sum, 0.f) : sum;
+    }
+}
+
+static inline int32_t argmax(const float *logits, int32_t num_logits)
+{
+    int32_t best = 0;
+    for (int32_t i = 1; i < num_logits; i++) {
+        if (logits[i] > logits[best]) {
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+// Drives every agent on the frozen team with the MLP loaded by the Manager,
+// greedily picking each action head's highest logit.
+inline void frozenPolicySystem(Engine &ctx,
+                               SimEntity sim_e,
+                               AgentType agent_type,
+                               const AgentPrepCounter &prep_counter,
+                               const RelativeAgentObservations &agent_obs,
+                               const RelativeBoxObservations &box_obs,
+                               const RelativeRampObservations &ramp_obs,
+                               const AgentVisibilityMasks &agent_vis,
+                               const BoxVisibilityMasks &box_vis,
+                               const RampVisibilityMasks &ramp_vis,
+                               const Lidar &lidar,
+                               Action &action)
+{
+    if (sim_e.e == Entity::none() || agent_type != ctx.data().frozenTeam) {
+        return;
+    }
+
+    float buffers[2][MLPWeights::maxWidth];
+
+    float *in = buffers[0];
+    CountT num_in = 0;
+    auto append = [&](const auto &obs) {
+        memcpy(in + num_in, &obs, sizeof(obs));
+        num_in += sizeof(obs) / sizeof(float);
+    };
+
+    in[num_in++] = float(prep_counter.numPrepStepsLeft);
+    append(agent_obs);
+    append(box_obs);
+    append(ramp_obs);
+    append(agent_vis);
+    append(box_vis);
+    append(ramp_vis);
+    append(lidar);
+
+    const MLPWeights &mlp = ctx.data().frozenPolicy;
+    const float *params = mlp.params;
+    for (int32_t layer = 0; layer < mlp.numLayers; layer++) {
+        int32_t layer_in = mlp.dims[layer];
+        int32_t layer_out = mlp.dims[layer + 1];
+
+        const float *w = params;
+        const float *b = w + CountT(layer_in) * layer_out;
+        params = b + layer_out;
+
+        denseLayer(w, b, buffers[layer & 1], buffers[(layer + 1) & 1],
+                   layer_in, layer_out, layer + 1 < mlp.numLayers);
+    }
+
+    const float *logits = buffers[mlp.numLayers & 1];
+    action.x = argmax(logits, 11);
+    action.y = argmax(logits + 11, 11);
+    action.r = argmax(logits + 22, 11);
+    action.g = argmax(logits + 33, 2);
+    action.l = argmax(logits + 35, 2);
+}
+
 inline void movementSystem(Engine &ctx, Action &action, SimEntity sim_e,
                                  AgentType agent_type)
 {
@@ -249,90 +538,86 @@ inline void actionSystem(Engine &ctx, Action &action, SimEntity sim_e,
     if (sim_e.e == Entity::none()) return;
     if (agent_type == AgentType::Camera) return;
 
-    if (action.l == 1) {
-        Vector3 cur_pos = ctx.get<Position>(sim_e.e);
-        Quat cur_rot = ctx.get<Rotation>(sim_e.e);
+    Vector3 cur_pos = ctx.get<Position>(sim_e.e);
+    Quat cur_rot = ctx.get<Rotation>(sim_e.e);
+
+    auto &grab_data = ctx.get<GrabData>(sim_e.e);
+    bool holding = grab_data.constraintEntity != Entity::none();
+
+    bool try_lock = action.l == 1;
+    bool try_grab = action.g == 1 && !holding;
 
+    // Lock and grab both act on whatever is directly in front of the agent,
+    // so the forward ray is traced at most once and its hit shared.
+    Vector3 ray_o = cur_pos + 0.5f * math::up;
+    Vector3 ray_d = cur_rot.rotateVec(math::fwd);
+
+    Entity hit_entity = Entity::none();
+    float hit_t = 0.f;
+    if (try_lock || try_grab) {
         auto &bvh = ctx.singleton<broadphase::BVH>();
-        float hit_t;
         Vector3 hit_normal;
-        Entity lock_entity = bvh.traceRay(cur_pos + 0.5f * math::up,
-            cur_rot.rotateVec(math::fwd), &hit_t, &hit_normal, 2.5f);
-
-        if (lock_entity != Entity::none()) {
-            auto &owner = ctx.get<OwnerTeam>(lock_entity);
-            auto &response_type = ctx.get<ResponseType>(lock_entity);
-
-            if (response_type == ResponseType::Static) {
-                if ((agent_type == AgentType::Seeker &&
-                        owner == OwnerTeam::Seeker) ||
-                        (agent_type == AgentType::Hider &&
-                         owner == OwnerTeam::Hider)) {
-                    response_type = ResponseType::Dynamic;
-                    owner = OwnerTeam::None;
-                }
-            } else {
-                if (owner == OwnerTeam::None) {
-                    response_type = ResponseType::Static;
-                    owner = agent_type == AgentType::Hider ?
-                        OwnerTeam::Hider : OwnerTeam::Seeker;
-                }
-            }
+        hit_entity = bvh.traceRay(ray_o, ray_d, &hit_t, &hit_normal, 2.5f);
+
+        if (hit_entity != Entity::none()) {
+            wakeObject(ctx, hit_entity);
         }
     }
 
-    if (action.g == 1) {
-        Vector3 cur_pos = ctx.get<Position>(sim_e.e);
-        Quat cur_rot = ctx.get<Rotation>(sim_e.e);
-
-        auto &grab_data = ctx.get<GrabData>(sim_e.e);
-
-        if (grab_data.constraintEntity != Entity::none()) {
-            ctx.destroyEntity(grab_data.constraintEntity);
-            grab_data.constraintEntity = Entity::none();
+    if (try_lock && hit_entity != Entity::none()) {
+        auto &owner = ctx.get<OwnerTeam>(hit_entity);
+        auto &response_type = ctx.get<ResponseType>(hit_entity);
+
+        if (response_type == ResponseType::Static) {
+            if ((agent_type == AgentType::Seeker &&
+                    owner == OwnerTeam::Seeker) ||
+                    (agent_type == AgentType::Hider &&
+                     owner == OwnerTeam::Hider)) {
+                response_type = ResponseType::Dynamic;
+                owner = OwnerTeam::None;
+            }
         } else {
-            auto &bvh = ctx.singleton<broadphase::BVH>();
-            float hit_t;
-            Vector3 hit_normal;
-
-            Vector3 ray_o = cur_pos + 0.5f * math::up;
-            Vector3 ray_d = cur_rot.rotateVec(math::fwd);
-
-            Entity grab_entity =
-                bvh.traceRay(ray_o, ray_d, &hit_t, &hit_normal, 2.5f);
-
-            if (grab_entity != Entity::none()) {
-                auto &owner = ctx.get<OwnerTeam>(grab_entity);
-                auto &response_type = ctx.get<ResponseType>(grab_entity);
+            if (owner == OwnerTeam::None) {
+                response_type = ResponseType::Static;
+                owner = agent_type == AgentType::Hider ?
+                    OwnerTeam::Hider : OwnerTeam::Seeker;
+                ctx.data().numLockEvents.fetch_add_relaxed(1);
+            }
+        }
+    }
 
-                if (owner == OwnerTeam::None &&
-                    response_type == ResponseType::Dynamic) {
+    if (action.g == 1 && holding) {
+        ctx.destroyEntity(grab_data.constraintEntity);
+        grab_data.constraintEntity = Entity::none();
+    } else if (try_grab && hit_entity != Entity::none()) {
+        auto &owner = ctx.get<OwnerTeam>(hit_entity);
+        auto &response_type = ctx.get<ResponseType>(hit_entity);
 
-                    Entity constraint_entity =
-                        ctx.makeEntity<ConstraintData>();
-                    grab_data.constraintEntity = constraint_entity;
+        if (owner == OwnerTeam::None &&
+            response_type == ResponseType::Dynamic) {
 
-                    Vector3 other_pos = ctx.get<Position>(grab_entity);
-                    Quat other_rot = ctx.get<Rotation>(grab_entity);
+            Vector3 other_pos = ctx.get<Position>(hit_entity);
+            Quat other_rot = ctx.get<Rotation>(hit_entity);
 
-                    Vector3 r1 = 1.25f * math::fwd + 0.5f * math::up;
+            Vector3 r1 = 1.25f * math::fwd + 0.5f * math::up;
 
-                    Vector3 hit_pos = ray_o + ray_d * hit_t;
-                    Vector3 r2 =
-                        other_rot.inv().rotateVec(hit_pos - other_pos);
+            Vector3 hit_pos = ray_o + ray_d * hit_t;
+            Vector3 r2 =
+                other_rot.inv().rotateVec(hit_pos - other_pos);
 
-                    Quat attach1 = { 1, 0, 0, 0 };
-                    Quat attach2 = (other_rot.inv() * cur_rot).normalize();
+            Quat attach1 = { 1, 0, 0, 0 };
+            Quat attach2 = (other_rot.inv() * cur_rot).normalize();
 
-                    float separation = hit_t - 1.25f;
+            float separation = hit_t - 1.25f;
 
-                    ctx.get<JointConstraint>(constraint_entity) =
-                        JointConstraint::setupFixed(sim_e.e, grab_entity,
-                                                    attach1, attach2,
-                                                    r1, r2, separation);
+            Entity constraint_entity = ctx.makeEntity<ConstraintData>();
+            grab_data.constraintEntity = constraint_entity;
 
-                }
-            }
+            ctx.get<JointConstraint>(constraint_entity) =
+                JointConstraint::setupFixed(sim_e.e, hit_entity,
+                                            attach1, attach2,
+                                            r1, r2, separation);
+            ctx.data().numGrabEvents.fetch_add_relaxed(1);
         }
     }
 
@@ -356,6 +641,263 @@ inline void agentZeroVelSystem(Engine &,
     vel.angular = Vector3::zero();
 }
 
+inline void gatherWorldFrameSystem(Engine &ctx, WorldFrameObjects &frame)
+{
+    auto gatherSlot = [&](CountT slot, Entity e) {
+        Vector3 pos = ctx.get<Position>(e);
+        Vector3 vel = ctx.get<Velocity>(e).linear;
+
+        frame.posX[slot] = pos.x;
+        frame.posY[slot] = pos.y;
+        frame.velX[slot] = vel.x;
+        frame.velY[slot] = vel.y;
+        frame.valid[slot] = 1.f;
+    };
+
+    // Locked objects are Static and can't move until they are unlocked, so
+    // once gathered their entries stay valid.
+    auto isCachedStatic = [&](CountT slot, Entity e) {
+        uint32_t slot_bit = 1u << uint32_t(slot);
+        if (ctx.get<ResponseType>(e) != ResponseType::Static) {
+            frame.staticCached &= ~slot_bit;
+            return false;
+        }
+
+        if ((frame.staticCached & slot_bit) != 0) {
+            return true;
+        }
+
+        frame.staticCached |= slot_bit;
+        return false;
+    };
+
+    auto clearSlot = [&](CountT slot) {
+        frame.posX[slot] = 0.f;
+        frame.posY[slot] = 0.f;
+        frame.velX[slot] = 0.f;
+        frame.velY[slot] = 0.f;
+        frame.valid[slot] = 0.f;
+    };
+
+    CountT num_boxes = ctx.data().numActiveBoxes;
+    for (CountT box_idx = 0; box_idx < consts::maxBoxes; box_idx++) {
+        if (box_idx >= num_boxes) {
+            clearSlot(box_idx);
+            frame.yaw[box_idx] = 0.f;
+            continue;
+        }
+
+        Entity box_e = ctx.data().boxes[box_idx];
+        if (isCachedStatic(box_idx, box_e)) {
+            continue;
+        }
+
+        gatherSlot(box_idx, box_e);
+        frame.yaw[box_idx] = ctx.get<Yaw>(box_e).yaw;
+    }
+
+    CountT num_ramps = ctx.data().numActiveRamps;
+    for (CountT ramp_idx = 0; ramp_idx < consts::maxRamps; ramp_idx++) {
+        CountT slot = consts::maxBoxes + ramp_idx;
+
+        if (ramp_idx >= num_ramps) {
+            clearSlot(slot);
+            frame.yaw[slot] = 0.f;
+            continue;
+        }
+
+        Entity ramp_e = ctx.data().ramps[ramp_idx];
+        if (isCachedStatic(slot, ramp_e)) {
+            continue;
+        }
+
+        gatherSlot(slot, ramp_e);
+        frame.yaw[slot] = ctx.get<Yaw>(ramp_e).yaw;
+    }
+
+    CountT num_agents = ctx.data().numActiveAgents;
+    for (CountT agent_idx = 0; agent_idx < consts::maxAgents; agent_idx++) {
+        CountT slot = consts::maxBoxes + consts::maxRamps + agent_idx;
+
+        if (agent_idx >= num_agents) {
+            clearSlot(slot);
+            frame.agentInterfaces[agent_idx] = Entity::none();
+            continue;
+        }
+
+        Entity agent_iface = ctx.data().agentInterfaces[agent_idx];
+        frame.agentInterfaces[agent_idx] = agent_iface;
+        Entity agent_sim_e = ctx.get<SimEntity>(agent_iface).e;
+
+        // Debug camera agents have no Velocity component, so only their
+        // position is reported.
+        if (ctx.get<AgentType>(agent_iface) == AgentType::Camera) {
+            Vector3 pos = ctx.get<Position>(agent_sim_e);
+            frame.posX[slot] = pos.x;
+            frame.posY[slot] = pos.y;
+            frame.velX[slot] = 0.f;
+            frame.velY[slot] = 0.f;
+            frame.valid[slot] = 1.f;
+            continue;
+        }
+
+        gatherSlot(slot, agent_sim_e);
+    }
+}
+
+// Footprint radius of each WorldFrameObjects slot, used for the conservative
+// proximity tests that decide when sleeping objects may be disturbed.
+static inline float slotRadius(Engine &ctx, CountT slot)
+{
+    if (slot < consts::maxBoxes) {
+        return 0.5f * ctx.data().boxSizes[slot].length();
+    } else if (slot < consts::maxBoxes + consts::maxRamps) {
+        return 2.25f;
+    } else {
+        return 1.42f;
+    }
+}
+
+// True if an agent, or a box / ramp that is awake and moving, is close
+// enough to slot to touch it during the next step.
+static inline bool nearActivity(Engine &ctx,
+                                const WorldFrameObjects &frame,
+                                const bool *moving,
+                                CountT slot)
+{
+    float radius = slotRadius(ctx, slot);
+    float x = frame.posX[slot];
+    float y = frame.posY[slot];
+
+    for (CountT i = 0; i < consts::maxTrackedObjects; i++) {
+        if (i == slot || frame.valid[i] == 0.f) {
+            continue;
+        }
+
+        bool is_agent = i >= consts::maxBoxes + consts::maxRamps;
+        if (!is_agent && !moving[i]) {
+            continue;
+        }
+
+        float dx = frame.posX[i] - x;
+        float dy = frame.posY[i] - y;
+        float range = radius + slotRadius(ctx, i) + sleepWakeMargin;
+
+        if (dx * dx + dy * dy < range * range) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template <typename Fn>
+static inline void forEachSleepableSlot(Engine &ctx, Fn &&fn)
+{
+    for (CountT box_idx = 0; box_idx < ctx.data().numActiveBoxes;
+         box_idx++) {
+        fn(box_idx, ctx.data().boxes[box_idx]);
+    }
+
+    for (CountT ramp_idx = 0; ramp_idx < ctx.data().numActiveRamps;
+         ramp_idx++) {
+        fn(consts::maxBoxes + ramp_idx, ctx.data().ramps[ramp_idx]);
+    }
+}
+
+// Runs before the substeps: wakes sleeping objects that something is about
+// to collide with or push.
+//
+// frame was gathered at the end of the previous step. Nothing has moved
+// since, so its positions and velocities are still current, but anything
+// this step's forces will do is not in it: every agent is treated as active,
+// and sleepWakeMargin has to cover how far an agent can travel in one step.
+// Grab and lock targets are woken directly by actionSystem, which this node
+// depends on, so the tests here never race with those writes.
+inline void wakeSystem(Engine &ctx, WorldFrameObjects &frame)
+{
+    bool moving[consts::maxTrackedObjects] = {};
+    forEachSleepableSlot(ctx, [&](CountT slot, Entity e) {
+        if (ctx.get<ResponseType>(e) != ResponseType::Dynamic) {
+            return;
+        }
+
+        float vx = frame.velX[slot];
+        float vy = frame.velY[slot];
+        moving[slot] = vx * vx + vy * vy >=
+            sleepLinearSpeed * sleepLinearSpeed;
+    });
+
+    forEachSleepableSlot(ctx, [&](CountT slot, Entity e) {
+        if (!ctx.get<SleepState>(e).asleep) {
+            return;
+        }
+
+        Vector3 force = ctx.get<ExternalForce>(e);
+        if (force.x != 0.f || force.y != 0.f || force.z != 0.f ||
+                nearActivity(ctx, frame, moving, slot)) {
+            wakeObject(ctx, e);
+        }
+    });
+}
+
+// Runs at the end of the step: counts how long each unlocked object has been
+// at rest and puts it to sleep once it has been quiet for numStepsToSleep.
+inline void sleepSystem(Engine &ctx, WorldFrameObjects &frame)
+{
+    bool moving[consts::maxTrackedObjects] = {};
+    forEachSleepableSlot(ctx, [&](CountT slot, Entity e) {
+        if (ctx.get<ResponseType>(e) != ResponseType::Dynamic) {
+            return;
+        }
+
+        const Velocity &vel = ctx.get<Velocity>(e);
+        moving[slot] =
+            vel.linear.length2() >= sleepLinearSpeed * sleepLinearSpeed ||
+            vel.angular.length2() >= sleepAngularSpeed * sleepAngularSpeed;
+    });
+
+    forEachSleepableSlot(ctx, [&](CountT slot, Entity e) {
+        SleepState &sleep_state = ctx.get<SleepState>(e);
+
+        if (ctx.get<ResponseType>(e) != ResponseType::Dynamic ||
+                ctx.get<OwnerTeam>(e) != OwnerTeam::None) {
+            sleep_state.numQuietSteps = 0;
+            return;
+        }
+
+        if (moving[slot] || nearActivity(ctx, frame, moving, slot)) {
+            sleep_state.numQuietSteps = 0;
+            return;
+        }
+
+        if (++sleep_state.numQuietSteps < numStepsToSleep) {
+            return;
+        }
+
+        sleep_state.asleep = 1;
+        ctx.get<ResponseType>(e) = ResponseType::Static;
+        ctx.get<Velocity>(e) = {
+            Vector3::zero(),
+            Vector3::zero(),
+        };
+    });
+}
+
+inline void updateYawSystem(Engine &,
+                            const Rotation &rot,
+                            ResponseType response_type,
+                            Yaw &yaw)
+{
+    // Static bodies (walls, locked objects) haven't moved since their yaw
+    // was last written, either at spawn or on the step they were locked.
+    if (response_type == ResponseType::Static) {
+        return;
+    }
+
+    yaw.yaw = quatToYaw(rot);
+}
+
 inline void collectObservationsSystem(Engine &ctx,
                                       Entity agent_e,
                                       SimEntity sim_e,
@@ -374,39 +916,71 @@ inline void collectObservationsSystem(Engine &ctx,
         prep_counter.numPrepStepsLeft = numPrepSteps - cur_step;
     } 
 
+    const WorldFrameObjects &frame = ctx.singleton<WorldFrameObjects>();
+
     Vector3 agent_pos = ctx.get<Position>(sim_e.e);
     Quat agent_rot = ctx.get<Rotation>(sim_e.e);
+    float agent_yaw = ctx.get<Yaw>(sim_e.e).yaw;
+
+    // Agents only rotate about z, so agent_rot.inv() restricted to the
+    // ground plane is a 2D rotation by -yaw.
+    Vector3 agent_right = agent_rot.rotateVec(math::right);
+    float cos_yaw = agent_right.x;
+    float sin_yaw = agent_right.y;
+
+    float rel_pos_x[consts::maxTrackedObjects];
+    float rel_pos_y[consts::maxTrackedObjects];
+    float rel_vel_x[consts::maxTrackedObjects];
+    float rel_vel_y[consts::maxTrackedObjects];
+
+    for (CountT i = 0; i < consts::maxTrackedObjects; i++) {
+        float dx = frame.posX[i] - agent_pos.x;
+        float dy = frame.posY[i] - agent_pos.y;
+        float vx = frame.velX[i];
+        float vy = frame.velY[i];
+        float valid = frame.valid[i];
+
+        rel_pos_x[i] = valid * (cos_yaw * dx + sin_yaw * dy);
+        rel_pos_y[i] = valid * (cos_yaw * dy - sin_yaw * dx);
+        rel_vel_x[i] = valid * (cos_yaw * vx + sin_yaw * vy);
+        rel_vel_y[i] = valid * (cos_yaw * vy - sin_yaw * vx);
+    }
+
+    auto relativeYaw = [&](CountT slot) {
+        float relative_yaw = wrapAngle(agent_yaw - frame.yaw[slot]);
+
+#ifdef GPU_HIDESEEK_VALIDATE_YAW
+        // Reads the object's current rotation rather than a copy in
+        // WorldFrameObjects, so the exported layout doesn't depend on the
+        // define. This also checks the cached yaw of locked objects.
+        Entity obj_e = slot < consts::maxBoxes ? ctx.data().boxes[slot] :
+            ctx.data().ramps[slot - consts::maxBoxes];
+        Quat relative_rot = agent_rot * ctx.get<Rotation>(obj_e).inv();
+        float reference_yaw = quatToYaw(relative_rot);
+        float yaw_err = fabsf(wrapAngle(relative_yaw - reference_yaw));
+        if (yaw_err > 1e-3f) {
+            FATAL("Yaw fast path mismatch (world %d, slot %d): %f vs %f",
+                  (int)ctx.worldID().idx, (int)slot,
+                  relative_yaw, reference_yaw);
+        }
+#endif
+
+        return relative_yaw;
+    };
 
     CountT num_boxes = ctx.data().numActiveBoxes;
     for (CountT box_idx = 0; box_idx < consts::maxBoxes; box_idx++) {
         auto &obs = box_obs.obs[box_idx];
 
         if (box_idx >= num_boxes) {
-            obs= {};
+            obs = {};
             continue;
         }
 
-        Entity box_e = ctx.data().boxes[box_idx];
-
-        Vector3 box_pos = ctx.get<Position>(box_e);
-        Vector3 box_vel = ctx.get<Velocity>(box_e).linear;
-        Quat box_rot = ctx.get<Rotation>(box_e);
-
-        Vector3 box_relative_pos =
-            agent_rot.inv().rotateVec(box_pos - agent_pos);
-        Vector3 box_relative_vel =
-            agent_rot.inv().rotateVec(box_vel);
-
-        obs.pos = { box_relative_pos.x, box_relative_pos.y };
-        obs.vel = { box_relative_vel.x, box_relative_vel.y };
+        obs.pos = { rel_pos_x[box_idx], rel_pos_y[box_idx] };
+        obs.vel = { rel_vel_x[box_idx], rel_vel_y[box_idx] };
         obs.boxSize = ctx.data().boxSizes[box_idx];
-
-        Quat relative_rot = agent_rot * box_rot.inv();
-        obs.boxRotation = atan2f(
-            2.f * (relative_rot.w * relative_rot.z +
-                   relative_rot.x * relative_rot.y),
-            1.f - 2.f * (relative_rot.y * relative_rot.y +
-                         relative_rot.z * relative_rot.z));
+        obs.boxRotation = relativeYaw(box_idx);
     }
 
     CountT num_ramps = ctx.data().numActiveRamps;
@@ -418,26 +992,11 @@ inline void collectObservationsSystem(Engine &ctx,
             continue;
         }
 
-        Entity ramp_e = ctx.data().ramps[ramp_idx];
-
-        Vector3 ramp_pos = ctx.get<Position>(ramp_e);
-        Vector3 ramp_vel = ctx.get<Velocity>(ramp_e).linear;
-        Quat ramp_rot = ctx.get<Rotation>(ramp_e);
-
-        Vector3 ramp_relative_pos =
-            agent_rot.inv().rotateVec(ramp_pos - agent_pos);
-        Vector3 ramp_relative_vel =
-            agent_rot.inv().rotateVec(ramp_vel);
+        CountT slot = consts::maxBoxes + ramp_idx;
 
-        obs.pos = { ramp_relative_pos.x, ramp_relative_pos.y };
-        obs.vel = { ramp_relative_vel.x, ramp_relative_vel.y };
-
-        Quat relative_rot = agent_rot * ramp_rot.inv();
-        obs.rampRotation = atan2f(
-            2.f * (relative_rot.w * relative_rot.z +
-                   relative_rot.x * relative_rot.y),
-            1.f - 2.f * (relative_rot.y * relative_rot.y +
-                         relative_rot.z * relative_rot.z));
+        obs.pos = { rel_pos_x[slot], rel_pos_y[slot] };
+        obs.vel = { rel_vel_x[slot], rel_vel_y[slot] };
+        obs.rampRotation = relativeYaw(slot);
     }
 
     CountT num_agents = ctx.data().numActiveAgents;
@@ -448,27 +1007,180 @@ inline void collectObservationsSystem(Engine &ctx,
             continue;
         }
 
-        Entity other_agent_e = ctx.data().agentInterfaces[agent_idx];
-        if (agent_e == other_agent_e) {
+        if (agent_e == frame.agentInterfaces[agent_idx]) {
             continue;
         }
 
-        Entity other_agent_sim_e = ctx.get<SimEntity>(other_agent_e).e;
+        CountT slot = consts::maxBoxes + consts::maxRamps + agent_idx;
 
         auto &obs = agent_obs.obs[num_other_agents++];
+        obs.pos = { rel_pos_x[slot], rel_pos_y[slot] };
+        obs.vel = { rel_vel_x[slot], rel_vel_y[slot] };
+    }
+}
+
+// Sets every cell of grid whose centre lies inside the convex quad. Corners
+// are in grid units, with cell centres at integer + 0.5.
+static inline void rasterizeQuad(OccupancyGrid &grid,
+                                 const Vector2 (&corners)[4])
+{
+    constexpr int32_t grid_size = consts::occupancyGridSize;
+
+    float min_y = fminf(fminf(corners[0].y, corners[1].y),
+                        fminf(corners[2].y, corners[3].y));
+    float max_y = fmaxf(fmaxf(corners[0].y, corners[1].y),
+                        fmaxf(corners[2].y, corners[3].y));
+
+    int32_t row_begin = std::max((int32_t)ceilf(min_y - 0.5f), 0);
+    int32_t row_end = std::min((int32_t)floorf(max_y - 0.5f), grid_size - 1);
+
+    for (int32_t row = row_begin; row <= row_end; row++) {
+        float y = float(row) + 0.5f;
+
+        float min_x = float(grid_size);
+        float max_x = -1.f;
+#pragma unroll
+        for (int32_t i = 0; i < 4; i++) {
+            Vector2 a = corners[i];
+            Vector2 b = corners[(i + 1) % 4];
+
+            if ((a.y <= y) != (b.y <= y)) {
+                float x = a.x + (y - a.y) / (b.y - a.y) * (b.x - a.x);
+                min_x = fminf(min_x, x);
+                max_x = fmaxf(max_x, x);
+            }
+        }
+
+        int32_t col_begin = std::max((int32_t)ceilf(min_x - 0.5f), 0);
+        int32_t col_end =
+            std::min((int32_t)floorf(max_x - 0.5f), grid_size - 1);
+
+        if (col_begin > col_end) {
+            continue;
+        }
+
+        uint32_t num_cols = uint32_t(col_end - col_begin + 1);
+        uint32_t mask = num_cols == 32 ? ~0u : ((1u << num_cols) - 1u);
+        grid.rows[row] |= mask << uint32_t(col_begin);
+    }
+}
+
+inline void occupancyGridSystem(Engine &ctx,
+                                Entity agent_e,
+                                SimEntity sim_e,
+                                AgentType agent_type,
+                                OccupancyGrid &grid)
+{
+    for (int32_t i = 0; i < consts::occupancyGridSize; i++) {
+        grid.rows[i] = 0;
+    }
+
+    if (sim_e.e == Entity::none() || agent_type == AgentType::Camera) {
+        return;
+    }
+
+    const WorldFrameObjects &frame = ctx.singleton<WorldFrameObjects>();
+    const StaticGeometry &geo = ctx.singleton<StaticGeometry>();
+    const ObjectManager &obj_mgr = *ctx.singleton<ObjectData>().mgr;
 
-        Vector3 other_agent_pos =
-            ctx.get<Position>(other_agent_sim_e);
-        Vector3 other_agent_vel =
-            ctx.get<Velocity>(other_agent_sim_e).linear;
+    constexpr float grid_half_size =
+        0.5f * float(consts::occupancyGridSize);
+    constexpr float inv_cell_size = 1.f / consts::occupancyCellSize;
+    const float window_radius = 1.4143f * grid_half_size *
+        consts::occupancyCellSize;
 
-        Vector3 other_agent_relative_pos =
-            agent_rot.inv().rotateVec(other_agent_pos - agent_pos);
-        Vector3 other_agent_relative_vel =
-            agent_rot.inv().rotateVec(other_agent_vel);
+    Vector3 agent_pos = ctx.get<Position>(sim_e.e);
+    float agent_yaw = ctx.get<Yaw>(sim_e.e).yaw;
+    float cos_agent = cosf(agent_yaw);
+    float sin_agent = sinf(agent_yaw);
+
+    // Footprint given as the [lo, hi] rectangle in the object's frame.
+    auto addFootprint = [&](float x, float y, float yaw,
+                            Vector2 lo, Vector2 hi) {
+        float dx = x - agent_pos.x;
+        float dy = y - agent_pos.y;
+
+        float extent = sqrtf(fmaxf(lo.x * lo.x, hi.x * hi.x) +
+                             fmaxf(lo.y * lo.y, hi.y * hi.y));
+        if (dx * dx + dy * dy >
+                (window_radius + extent) * (window_radius + extent)) {
+            return;
+        }
+
+        Vector2 center {
+            cos_agent * dx + sin_agent * dy,
+            -sin_agent * dx + cos_agent * dy,
+        };
+
+        float cos_rel = cosf(yaw - agent_yaw);
+        float sin_rel = sinf(yaw - agent_yaw);
+
+        Vector2 local[4] = {
+            { lo.x, lo.y },
+            { hi.x, lo.y },
+            { hi.x, hi.y },
+            { lo.x, hi.y },
+        };
+
+        Vector2 corners[4];
+#pragma unroll
+        for (int32_t i = 0; i < 4; i++) {
+            Vector2 p = local[i];
+            corners[i] = {
+                (center.x + cos_rel * p.x - sin_rel * p.y) * inv_cell_size +
+                    grid_half_size,
+                (center.y + sin_rel * p.x + cos_rel * p.y) * inv_cell_size +
+                    grid_half_size,
+            };
+        }
+
+        rasterizeQuad(grid, corners);
+    };
+
+    for (CountT i = 0; i < geo.numBoxes; i++) {
+        const AABB &box = geo.boxes[i];
+        Vector2 half {
+            0.5f * (box.pMax.x - box.pMin.x),
+            0.5f * (box.pMax.y - box.pMin.y),
+        };
+
+        addFootprint(0.5f * (box.pMin.x + box.pMax.x),
+                     0.5f * (box.pMin.y + box.pMax.y),
+                     0.f, { -half.x, -half.y }, half);
+    }
 
-        obs.pos = { other_agent_relative_pos.x, other_agent_relative_pos.y };
-        obs.vel = { other_agent_relative_vel.x, other_agent_relative_vel.y };
+    for (CountT i = 0; i < ctx.data().numActiveBoxes; i++) {
+        Vector2 size = ctx.data().boxSizes[i];
+        Vector2 half { 0.5f * size.x, 0.5f * size.y };
+        addFootprint(frame.posX[i], frame.posY[i], frame.yaw[i],
+                     { -half.x, -half.y }, half);
+    }
+
+    const AABB &ramp_aabb = obj_mgr.rigidBodyAABBs[5];
+    for (CountT i = 0; i < ctx.data().numActiveRamps; i++) {
+        CountT slot = consts::maxBoxes + i;
+        addFootprint(frame.posX[slot], frame.posY[slot], frame.yaw[slot],
+                     { ramp_aabb.pMin.x, ramp_aabb.pMin.y },
+                     { ramp_aabb.pMax.x, ramp_aabb.pMax.y });
+    }
+
+    const AABB &agent_aabb = obj_mgr.rigidBodyAABBs[4];
+    for (CountT i = 0; i < ctx.data().numActiveAgents; i++) {
+        Entity other_iface = frame.agentInterfaces[i];
+        if (other_iface == agent_e) {
+            continue;
+        }
+
+        auto other_yaw = ctx.getSafe<Yaw>(ctx.get<SimEntity>(other_iface).e);
+        if (!other_yaw.valid()) {
+            continue;
+        }
+
+        CountT slot = consts::maxBoxes + consts::maxRamps + i;
+        addFootprint(frame.posX[slot], frame.posY[slot],
+                     other_yaw.value().yaw,
+                     { agent_aabb.pMin.x, agent_aabb.pMin.y },
+                     { agent_aabb.pMax.x, agent_aabb.pMax.y });
     }
 }
 
@@ -666,6 +1378,63 @@ inline void lidarSystem(Engine &ctx,
 #endif
 }
 
+// CPU fallback for depth observations when there is no batch renderer. Casts
+// a 90 degree pinhole grid from each agent's camera in 8x8 pixel tiles, so
+// neighbouring rays walk the same BVH nodes back to back. Depth is planar
+// (along the view direction), with 0 for rays that hit nothing.
+inline void depthRenderSystem(Engine &ctx,
+                              Entity agent_e,
+                              SimEntity sim_e)
+{
+    if (sim_e.e == Entity::none()) {
+        return;
+    }
+
+    constexpr int32_t tile_size = 8;
+    const float tan_half_fov = tanf(toRadians(90.f / 2.f));
+
+    int32_t width = ctx.data().depthWidth;
+    int32_t height = ctx.data().depthHeight;
+    float aspect = float(width) / float(height);
+
+    float *depth_out = ctx.data().depthBuffer +
+        (CountT)ctx.loc(agent_e).row * width * height;
+
+    Vector3 pos = ctx.get<Position>(sim_e.e);
+    Quat rot = ctx.get<Rotation>(sim_e.e);
+    auto &bvh = ctx.singleton<broadphase::BVH>();
+
+    Vector3 cam_pos = pos + Vector3 { 0, 0, 0.2f };
+    Vector3 cam_fwd = rot.rotateVec(math::fwd);
+    Vector3 cam_right = rot.rotateVec(math::right) * tan_half_fov * aspect;
+    Vector3 cam_up = rot.rotateVec(math::up) * tan_half_fov;
+
+    for (int32_t tile_y = 0; tile_y < height; tile_y += tile_size) {
+        for (int32_t tile_x = 0; tile_x < width; tile_x += tile_size) {
+            int32_t max_y = std::min(tile_y + tile_size, height);
+            int32_t max_x = std::min(tile_x + tile_size, width);
+
+            for (int32_t y = tile_y; y < max_y; y++) {
+                float v = 1.f - 2.f * (float(y) + 0.5f) / float(height);
+
+                for (int32_t x = tile_x; x < max_x; x++) {
+                    float u = 2.f * (float(x) + 0.5f) / float(width) - 1.f;
+
+                    Vector3 ray_d = cam_fwd + u * cam_right + v * cam_up;
+
+                    float hit_t;
+                    Vector3 hit_normal;
+                    Entity hit_entity = bvh.traceRay(cam_pos, ray_d,
+                        &hit_t, &hit_normal, 200.f);
+
+                    depth_out[y * width + x] =
+                        hit_entity == Entity::none() ? 0.f : hit_t;
+                }
+            }
+        }
+    }
+}
+
 // FIXME: refactor this so the observation systems can reuse these raycasts
 // (unless a reset has occurred)
 inline void rewardsVisSystem(Engine &ctx,
@@ -711,6 +1480,11 @@ inline void rewardsVisSystem(Engine &ctx,
     }
 }
 
+static inline bool outOfBounds(Vector3 pos)
+{
+    return fabsf(pos.x) >= 18.f || fabsf(pos.y) >= 18.f;
+}
+
 inline void outputRewardsDonesSystem(Engine &ctx,
                                     SimEntity sim_e,
                                     AgentType agent_type)
@@ -742,15 +1516,43 @@ inline void outputRewardsDonesSystem(Engine &ctx,
         reward_val *= -1.f;
     }
 
-    Vector3 pos = ctx.get<Position>(sim_e.e);
-
-    if (fabsf(pos.x) >= 18.f || fabsf(pos.y) >= 18.f) {
+    if (outOfBounds(ctx.get<Position>(sim_e.e))) {
         reward_val -= 10.f;
     }
 
     *reward_out = reward_val;
 }
 
+// Accumulates this step into the world's EpisodeStats. Grabs and locks are
+// counted for the whole episode, including the prep phase; the other totals
+// use the same prep phase gating as the rewards.
+inline void episodeStatsSystem(Engine &ctx, EpisodeStats &stats)
+{
+    stats.numGrabs += float(ctx.data().numGrabEvents.load_relaxed());
+    stats.numLocks += float(ctx.data().numLockEvents.load_relaxed());
+    ctx.data().numGrabEvents.store_relaxed(0);
+    ctx.data().numLockEvents.store_relaxed(0);
+
+    if (ctx.data().curEpisodeStep < numPrepSteps - 1) {
+        return;
+    }
+
+    float hider_team_reward = ctx.data().hiderTeamReward.load_relaxed();
+    stats.hiderTeamReturn += hider_team_reward;
+    if (hider_team_reward < 0.f) {
+        stats.numHiderSeenSteps += 1.f;
+    }
+
+    for (CountT i = 0; i < ctx.data().numActiveAgents; i++) {
+        Entity sim_e = ctx.get<SimEntity>(ctx.data().agentInterfaces[i]).e;
+
+        if (sim_e != Entity::none() &&
+                outOfBounds(ctx.get<Position>(sim_e))) {
+            stats.numOutOfBounds += 1.f;
+        }
+    }
+}
+
 inline void globalPositionsDebugSystem(Engine &ctx,
                                        GlobalDebugPositions &global_positions)
 {
@@ -799,6 +1601,261 @@ inline void globalPositionsDebugSystem(Engine &ctx,
     }
 }
 
+// Hashes (in a fixed order) the position, rotation and velocity of every
+// obstacle and agent, along with the episode step and RNG state.
+inline void stateHashSystem(Engine &ctx, StateHash &state_hash)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+
+    auto hashBytes = [&hash](const void *data, size_t num_bytes) {
+        const uint8_t *bytes = (const uint8_t *)data;
+        for (size_t i = 0; i < num_bytes; i++) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3;
+        }
+    };
+
+    auto hashEntity = [&](Entity e) {
+        Vector3 pos = ctx.get<Position>(e);
+        Quat rot = ctx.get<Rotation>(e);
+        hashBytes(&pos, sizeof(Vector3));
+        hashBytes(&rot, sizeof(Quat));
+
+        auto vel = ctx.getSafe<Velocity>(e);
+        if (vel.valid()) {
+            hashBytes(&vel.value(), sizeof(Velocity));
+        }
+    };
+
+    for (CountT i = 0; i < ctx.data().numObstacles; i++) {
+        hashEntity(ctx.data().obstacles[i]);
+    }
+
+    for (CountT i = 0; i < ctx.data().numActiveAgents; i++) {
+        hashEntity(ctx.get<SimEntity>(ctx.data().agentInterfaces[i]).e);
+    }
+
+    int64_t cur_step = ctx.data().curEpisodeStep;
+    uint64_t rng_key = ctx.data().rng.key();
+    uint64_t rng_ctr = ctx.data().rng.counter();
+    hashBytes(&cur_step, sizeof(int64_t));
+    hashBytes(&rng_key, sizeof(uint64_t));
+    hashBytes(&rng_ctr, sizeof(uint64_t));
+
+    state_hash.hash = hash;
+}
+
+// Copies agent e's ComponentT into row `row` of an AgentBuffers array, or
+// zeroes the row for an empty agent slot.
+template <typename ComponentT, typename ElemT>
+static inline void writeAgentRow(Engine &ctx, Entity e,
+                                 ElemT *base, CountT row)
+{
+    constexpr CountT num_elems = sizeof(ComponentT) / sizeof(ElemT);
+    static_assert(num_elems * sizeof(ElemT) == sizeof(ComponentT));
+
+    ElemT *out = base + row * num_elems;
+    if (e == Entity::none()) {
+        memset(out, 0, sizeof(ComponentT));
+    } else {
+        memcpy(out, &ctx.get<ComponentT>(e), sizeof(ComponentT));
+    }
+}
+
+static inline void writeObservationRows(Engine &ctx, Entity e,
+                                        const AgentBuffers &bufs, CountT row)
+{
+    writeAgentRow<AgentPrepCounter>(ctx, e, bufs.prepCounters, row);
+    writeAgentRow<AgentType>(ctx, e, bufs.agentTypes, row);
+    writeAgentRow<AgentActiveMask>(ctx, e, bufs.agentMasks, row);
+    writeAgentRow<RelativeAgentObservations>(ctx, e, bufs.agentData, row);
+    writeAgentRow<RelativeBoxObservations>(ctx, e, bufs.boxData, row);
+    writeAgentRow<RelativeRampObservations>(ctx, e, bufs.rampData, row);
+    writeAgentRow<AgentVisibilityMasks>(ctx, e, bufs.visibleAgents, row);
+    writeAgentRow<BoxVisibilityMasks>(ctx, e, bufs.visibleBoxes, row);
+    writeAgentRow<RampVisibilityMasks>(ctx, e, bufs.visibleRamps, row);
+    writeAgentRow<Lidar>(ctx, e, bufs.lidar, row);
+}
+
+// Copies the reward and done outputRewardsDonesSystem wrote for an agent
+// into row `row`, or zeroes them for an empty agent slot.
+static inline void writeRewardDoneRow(Engine &ctx, Entity agent_iface,
+                                      const AgentBuffers &bufs, CountT row)
+{
+    float reward = 0.f;
+    uint8_t done = 0;
+
+    if (agent_iface != Entity::none()) {
+        Entity sim_e = ctx.get<SimEntity>(agent_iface).e;
+
+        if (sim_e != Entity::none()) {
+            Loc l = ctx.loc(sim_e);
+            reward = ctx.data().rewardBuffer[l.row];
+            done = ctx.data().doneBuffer[l.row];
+        }
+    }
+
+    bufs.rewards[row] = reward;
+    bufs.dones[row] = done;
+}
+
+static inline CountT rolloutBaseRow(Engine &ctx, int32_t step)
+{
+    const RolloutBuffers &rollout = ctx.data().rollout;
+    return CountT(step) * CountT(rollout.numAgentSlots) +
+        CountT(ctx.worldID().idx) * consts::maxAgents;
+}
+
+static inline Entity agentSlotEntity(Engine &ctx, CountT slot)
+{
+    return slot < ctx.data().numActiveAgents ?
+        ctx.data().agentInterfaces[slot] : Entity::none();
+}
+
+// Records the observations each agent acted on and the action it took this
+// step. Observations aren't rewritten until after reset.
+inline void rolloutObservationsSystem(Engine &ctx, RolloutCursor &cursor)
+{
+    const RolloutBuffers &rollout = ctx.data().rollout;
+    cursor.step = *rollout.curStep;
+
+    if (cursor.step < 0) {
+        return;
+    }
+
+    CountT base_row = rolloutBaseRow(ctx, cursor.step);
+
+    for (CountT i = 0; i < consts::maxAgents; i++) {
+        Entity e = agentSlotEntity(ctx, i);
+
+        writeObservationRows(ctx, e, rollout.agents, base_row + i);
+        writeAgentRow<Action>(ctx, e, rollout.agents.actions, base_row + i);
+    }
+}
+
+// Records the rewards and dones output for this step, before reset replaces
+// the agents.
+inline void rolloutRewardsSystem(Engine &ctx, RolloutCursor &cursor)
+{
+    if (cursor.step < 0) {
+        return;
+    }
+
+    CountT base_row = rolloutBaseRow(ctx, cursor.step);
+
+    for (CountT i = 0; i < consts::maxAgents; i++) {
+        writeRewardDoneRow(ctx, agentSlotEntity(ctx, i),
+                           ctx.data().rollout.agents, base_row + i);
+    }
+}
+
+// Calls fn(agent_iface, row) for each of this world's hider and seeker rows
+// in the team-major layout, in agent creation order. agent_iface is none for
+// rows past the team's current size. Manager::triggerReset() keeps teams
+// within maxHiders / maxSeekers.
+template <typename Fn>
+static inline void forEachTeamRow(Engine &ctx, Fn &&fn)
+{
+    CountT world_idx = ctx.worldID().idx;
+    CountT hider_base = world_idx * consts::maxHiders;
+    CountT seeker_base = CountT(ctx.data().team.numWorlds) *
+        consts::maxHiders + world_idx * consts::maxSeekers;
+
+    CountT num_hiders = 0;
+    CountT num_seekers = 0;
+    for (CountT i = 0; i < ctx.data().numActiveAgents; i++) {
+        Entity agent_iface = ctx.data().agentInterfaces[i];
+        AgentType agent_type = ctx.get<AgentType>(agent_iface);
+
+        if (agent_type == AgentType::Hider) {
+            assert(num_hiders < consts::maxHiders);
+            fn(agent_iface, hider_base + num_hiders++);
+        } else if (agent_type == AgentType::Seeker) {
+            assert(num_seekers < consts::maxSeekers);
+            fn(agent_iface, seeker_base + num_seekers++);
+        }
+    }
+
+    for (; num_hiders < consts::maxHiders; num_hiders++) {
+        fn(Entity::none(), hider_base + num_hiders);
+    }
+
+    for (; num_seekers < consts::maxSeekers; num_seekers++) {
+        fn(Entity::none(), seeker_base + num_seekers);
+    }
+}
+
+// Moves each agent's action out of the team-major action buffer, leaving
+// the idle action behind like actionSystem does.
+inline void teamActionsSystem(Engine &ctx, WorldReset &)
+{
+    int32_t *actions = ctx.data().team.agents.actions;
+
+    forEachTeamRow(ctx, [&](Entity agent_iface, CountT row) {
+        Action &team_action = *(Action *)(actions + row * 5);
+
+        if (agent_iface != Entity::none()) {
+            ctx.get<Action>(agent_iface) = team_action;
+        }
+
+        team_action = {
+            .x = 5,
+            .y = 5,
+            .r = 5,
+            .g = 0,
+            .l = 0,
+        };
+    });
+}
+
+inline void teamRewardsSystem(Engine &ctx, WorldReset &)
+{
+    forEachTeamRow(ctx, [&](Entity agent_iface, CountT row) {
+        writeRewardDoneRow(ctx, agent_iface, ctx.data().team.agents, row);
+    });
+}
+
+inline void teamObservationsSystem(Engine &ctx, WorldReset &)
+{
+    forEachTeamRow(ctx, [&](Entity agent_iface, CountT row) {
+        writeObservationRows(ctx, agent_iface, ctx.data().team.agents, row);
+    });
+}
+
+// Runs after the end of step sort, so rows match the exported observation
+// tensors the next actions are computed from. Agents whose team has an
+// out of range policy ID are left ungrouped.
+inline void policyGroupSystem(Engine &ctx, PolicyGroupKeys &keys)
+{
+    const PolicyAssignment &assignment = ctx.singleton<PolicyAssignment>();
+    int32_t num_policies = ctx.data().numPolicies;
+
+    for (CountT i = 0; i < consts::maxAgents; i++) {
+        keys.key[i] = -1;
+        keys.row[i] = -1;
+
+        if (i >= ctx.data().numActiveAgents) {
+            continue;
+        }
+
+        Entity agent_iface = ctx.data().agentInterfaces[i];
+        AgentType agent_type = ctx.get<AgentType>(agent_iface);
+        if (agent_type == AgentType::Camera) {
+            continue;
+        }
+
+        bool is_hider = agent_type == AgentType::Hider;
+        int32_t policy = is_hider ?
+            assignment.hiderPolicy : assignment.seekerPolicy;
+        if (policy < 0 || policy >= num_policies) {
+            continue;
+        }
+
+        keys.key[i] = (is_hider ? 0 : num_policies) + policy;
+        keys.row[i] = (int32_t)ctx.loc(agent_iface).row;
+    }
+}
+
 #ifdef MADRONA_GPU_MODE
 template <typename ArchetypeT>
 TaskGraph::NodeID queueSortByWorld(TaskGraphBuilder &builder,
@@ -812,27 +1869,97 @@ TaskGraph::NodeID queueSortByWorld(TaskGraphBuilder &builder,
 
     return post_sort_reset_tmp;
 }
+
+template <typename ArchetypeT>
+TaskGraph::NodeID queueCompact(TaskGraphBuilder &builder,
+                               Span<const TaskGraph::NodeID> deps)
+{
+    auto compact_sys =
+        builder.addToGraph<CompactArchetypeNode<ArchetypeT>>(deps);
+    auto post_compact_reset_tmp =
+        builder.addToGraph<ResetTmpAllocNode>({compact_sys});
+
+    return post_compact_reset_tmp;
+}
 #endif
 
 void Sim::setupTasks(TaskGraphBuilder &builder, const Config &cfg)
 {
-    auto move_sys = builder.addToGraph<ParallelForNode<Engine, movementSystem,
-        Action, SimEntity, AgentType>>({});
+    // Built-in policies act on the observations gathered at the end of the
+    // previous step, the same ones the trainer's policy sees. They run in
+    // sequence, so the frozen policy wins for agents both would drive.
+    TaskGraph::NodeID policy_sys;
+    CountT num_policy_deps = 0;
+    if (cfg.enableTeamLayout) {
+        policy_sys = builder.addToGraph<ParallelForNode<Engine,
+            teamActionsSystem, WorldReset>>({});
+        num_policy_deps = 1;
+    }
 
-    auto broadphase_setup_sys = phys::RigidBodyPhysicsSystem::setupBroadphaseTasks(builder,
-        {move_sys});
+    if (cfg.enableScriptedPolicies) {
+        policy_sys = builder.addToGraph<ParallelForNode<Engine,
+            scriptedPolicySystem,
+                Entity,
+                SimEntity,
+                AgentType,
+                AgentVisibilityMasks,
+                ScriptedMemory,
+                Action
+            >>(Span<const TaskGraph::NodeID>(&policy_sys, num_policy_deps));
+        num_policy_deps = 1;
+    }
+
+    if (cfg.enableFrozenPolicy) {
+        policy_sys = builder.addToGraph<ParallelForNode<Engine,
+            frozenPolicySystem,
+                SimEntity,
+                AgentType,
+                AgentPrepCounter,
+                RelativeAgentObservations,
+                RelativeBoxObservations,
+                RelativeRampObservations,
+                AgentVisibilityMasks,
+                BoxVisibilityMasks,
+                RampVisibilityMasks,
+                Lidar,
+                Action
+            >>(Span<const TaskGraph::NodeID>(&policy_sys, num_policy_deps));
+        num_policy_deps = 1;
+    }
+
+    auto move_sys = builder.addToGraph<ParallelForNode<Engine, movementSystem,
+        Action, SimEntity, AgentType>>(
+            Span<const TaskGraph::NodeID>(&policy_sys, num_policy_deps));
+
+    auto broadphase_setup_sys =
+        phys::RigidBodyPhysicsSystem::setupBroadphaseTasks(builder,
+            {move_sys});
+
+    // actionSystem clears each Action once it's applied, so the step's
+    // actions get recorded before it runs.
+    auto pre_action = broadphase_setup_sys;
+    if (cfg.enableRollout) {
+        pre_action = builder.addToGraph<ParallelForNode<Engine,
+            rolloutObservationsSystem, RolloutCursor>>({broadphase_setup_sys});
+    }
 
     auto action_sys = builder.addToGraph<ParallelForNode<Engine, actionSystem,
-        Action, SimEntity, AgentType>>({broadphase_setup_sys});
+        Action, SimEntity, AgentType>>({pre_action});
+
+    auto wake_sys = builder.addToGraph<ParallelForNode<Engine,
+        wakeSystem, WorldFrameObjects>>({action_sys});
 
     auto substep_sys = phys::RigidBodyPhysicsSystem::setupSubstepTasks(builder,
-        {action_sys}, numPhysicsSubsteps);
+        {wake_sys}, numPhysicsSubsteps);
 
     auto agent_zero_vel = builder.addToGraph<ParallelForNode<Engine,
         agentZeroVelSystem, Velocity, viz::VizCamera>>(
             {substep_sys});
 
-    auto sim_done = agent_zero_vel;
+    auto update_yaw = builder.addToGraph<ParallelForNode<Engine,
+        updateYawSystem, Rotation, ResponseType, Yaw>>({agent_zero_vel});
+
+    auto sim_done = update_yaw;
 
     sim_done = phys::RigidBodyPhysicsSystem::setupCleanupTasks(
         builder, {sim_done});
@@ -849,18 +1976,38 @@ void Sim::setupTasks(TaskGraphBuilder &builder, const Config &cfg)
             AgentType
         >>({rewards_vis});
 
+    auto episode_stats = builder.addToGraph<ParallelForNode<Engine,
+        episodeStatsSystem, EpisodeStats>>({output_rewards});
+
+    auto rewards_done = episode_stats;
+    if (cfg.enableRollout) {
+        rewards_done = builder.addToGraph<ParallelForNode<Engine,
+            rolloutRewardsSystem, RolloutCursor>>({episode_stats});
+    }
+
+    if (cfg.enableTeamLayout) {
+        rewards_done = builder.addToGraph<ParallelForNode<Engine,
+            teamRewardsSystem, WorldReset>>({rewards_done});
+    }
+
     auto reset_sys = builder.addToGraph<ParallelForNode<Engine,
-        resetSystem, WorldReset>>({output_rewards});
+        resetSystem, WorldReset>>({rewards_done});
 
     auto clearTmp = builder.addToGraph<ResetTmpAllocNode>({reset_sys});
 
 #ifdef MADRONA_GPU_MODE
-    // FIXME: these 3 need to be compacted, but sorting is unnecessary
-    auto sort_cam_agent = queueSortByWorld<CameraAgent>(builder, {clearTmp});
-    auto sort_dyn_agent = queueSortByWorld<DynAgent>(builder, {sort_cam_agent});
-    auto sort_objects = queueSortByWorld<DynamicObject>(builder, {sort_dyn_agent});
+    // Only DynAgent and AgentInterface rows need world order: rewards and
+    // dones are written at the DynAgent row, and the exported observation
+    // columns are read per world. Camera agents and dynamic objects are
+    // only reached through entity handles, so filling the holes left by
+    // reset is enough and avoids a full sort on steps where nothing reset.
+    auto compact_cam_agent = queueCompact<CameraAgent>(builder, {clearTmp});
+    auto sort_dyn_agent =
+        queueSortByWorld<DynAgent>(builder, {compact_cam_agent});
+    auto compact_objects =
+        queueCompact<DynamicObject>(builder, {sort_dyn_agent});
     auto sort_agent_iface =
-        queueSortByWorld<AgentInterface>(builder, {sort_objects});
+        queueSortByWorld<AgentInterface>(builder, {compact_objects});
     auto reset_finish = sort_agent_iface;
 #else
     auto reset_finish = clearTmp;
@@ -886,9 +2033,17 @@ void Sim::setupTasks(TaskGraphBuilder &builder, const Config &cfg)
     (void)recycle_sys;
 #endif
     
+    // Every world needs this pass, not just those that reset: bodies moved
+    // during the substeps after the pre-action refit, and visibility and
+    // lidar trace against this tree.
     auto post_reset_broadphase = phys::RigidBodyPhysicsSystem::setupBroadphaseTasks(
         builder, {reset_finish});
 
+    auto gather_world_frame = builder.addToGraph<ParallelForNode<Engine,
+        gatherWorldFrameSystem,
+            WorldFrameObjects
+        >>({post_reset_broadphase});
+
     auto collect_observations = builder.addToGraph<ParallelForNode<Engine,
         collectObservationsSystem,
             Entity,
@@ -898,7 +2053,20 @@ void Sim::setupTasks(TaskGraphBuilder &builder, const Config &cfg)
             RelativeBoxObservations,
             RelativeRampObservations,
             AgentPrepCounter
-        >>({post_reset_broadphase});
+        >>({gather_world_frame});
+
+    auto sleep_sys = builder.addToGraph<ParallelForNode<Engine,
+        sleepSystem,
+            WorldFrameObjects
+        >>({gather_world_frame});
+
+    auto occupancy_grid = builder.addToGraph<ParallelForNode<Engine,
+        occupancyGridSystem,
+            Entity,
+            SimEntity,
+            AgentType,
+            OccupancyGrid
+        >>({gather_world_frame});
 
 
 #ifdef MADRONA_GPU_MODE
@@ -932,9 +2100,40 @@ void Sim::setupTasks(TaskGraphBuilder &builder, const Config &cfg)
             GlobalDebugPositions
         >>({reset_finish});
 
+    if (cfg.enableDepthRender) {
+        builder.addToGraph<ParallelForNode<Engine,
+            depthRenderSystem,
+                Entity,
+                SimEntity
+            >>({post_reset_broadphase});
+    }
+
+    if (cfg.numPolicies > 0) {
+        builder.addToGraph<ParallelForNode<Engine,
+            policyGroupSystem,
+                PolicyGroupKeys
+            >>({reset_finish});
+    }
+
+    if (cfg.enableTeamLayout) {
+        builder.addToGraph<ParallelForNode<Engine,
+            teamObservationsSystem,
+                WorldReset
+            >>({collect_observations, compute_visibility, lidar});
+    }
+
+    if (cfg.enableStateHash) {
+        builder.addToGraph<ParallelForNode<Engine,
+            stateHashSystem,
+                StateHash
+            >>({sleep_sys});
+    }
+
     (void)lidar;
     (void)compute_visibility;
     (void)collect_observations;
+    (void)sleep_sys;
+    (void)occupancy_grid;
     (void)global_positions_debug;
 }
 
@@ -942,9 +2141,16 @@ Sim::Sim(Engine &ctx,
          const Config &cfg,
          const WorldInit &init)
     : WorldBase(ctx),
-      episodeMgr(init.episodeMgr),
       rewardBuffer(init.rewardBuffer),
-      doneBuffer(init.doneBuffer)
+      doneBuffer(init.doneBuffer),
+      depthBuffer(init.depthBuffer),
+      depthWidth((int32_t)init.depthWidth),
+      depthHeight((int32_t)init.depthHeight),
+      rollout(init.rollout),
+      frozenPolicy(init.frozenPolicy),
+      frozenTeam(cfg.frozenPolicyHiders ? AgentType::Hider : AgentType::Seeker),
+      numPolicies(cfg.numPolicies),
+      team(init.team)
 {
     CountT max_total_entities =
         std::max(init.maxEntitiesPerWorld, uint32_t(3 + 3 + 9 + 2 + 6)) + 100;
@@ -978,8 +2184,14 @@ Sim::Sim(Engine &ctx,
     enableViewer = cfg.enableViewer;
     autoReset = cfg.autoReset;
 
+    ctx.singleton<WorldSeed>() = {
+        .baseSeed = (uint32_t)ctx.worldID().idx,
+        .episodeIdx = 0,
+    };
+
     resetEnvironment(ctx);
     generateEnvironment(ctx, 1, 3, 2);
+    countEpisodeStats = false;
     ctx.singleton<WorldReset>() = {
         .resetLevel = 0,
         .numHiders = 3,
@@ -987,6 +2199,18 @@ Sim::Sim(Engine &ctx,
     };
 
     ctx.data().hiderTeamReward.store_relaxed(1.f);
+    ctx.singleton<StateHash>().hash = 0;
+    ctx.singleton<RolloutCursor>().step = -1;
+    ctx.singleton<EpisodeStats>() = {};
+    ctx.singleton<CompletedEpisodeStats>() = {};
+    ctx.singleton<ScriptedAgents>() = {};
+    ctx.singleton<PolicyAssignment>() = {};
+
+    PolicyGroupKeys &policy_keys = ctx.singleton<PolicyGroupKeys>();
+    for (CountT i = 0; i < consts::maxAgents; i++) {
+        policy_keys.key[i] = -1;
+        policy_keys.row[i] = -1;
+    }
 }
 
 MADRONA_BUILD_MWGPU_ENTRY(Engine, Sim, Config, WorldInit);
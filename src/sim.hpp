@@ -29,13 +29,31 @@ namespace consts {
 static inline constexpr int32_t maxBoxes = 9;
 static inline constexpr int32_t maxRamps = 2;
 static inline constexpr int32_t maxAgents = 6;
+static inline constexpr int32_t maxHiders = 3;
+static inline constexpr int32_t maxSeekers = 3;
+static inline constexpr int32_t maxTrackedObjects =
+    maxBoxes + maxRamps + maxAgents;
+static inline constexpr int32_t maxStaticBoxes = 32;
+static inline constexpr int32_t occupancyGridSize = 32;
+static inline constexpr float occupancyCellSize = 0.5f;
+static inline constexpr int32_t episodeLen = 240;
 
 }
 
+static_assert(consts::maxHiders + consts::maxSeekers == consts::maxAgents);
+
 struct Config {
     bool enableBatchRender;
     bool enableViewer;
     bool autoReset;
+    bool enableStateHash;
+    bool enableDepthRender;
+    bool enableRollout;
+    bool enableScriptedPolicies;
+    bool enableFrozenPolicy;
+    bool frozenPolicyHiders; // false freezes the seekers
+    int32_t numPolicies; // 0 disables policy grouping
+    bool enableTeamLayout;
 };
 
 class Engine;
@@ -46,6 +64,61 @@ struct WorldReset {
     int32_t numSeekers;
 };
 
+// Each world's levels come from its own seed mixed with its own episode
+// counter, so they don't depend on how worlds are scheduled. baseSeed
+// defaults to the world index and can be overwritten from Python; a new
+// seed takes effect at the world's next reset.
+struct WorldSeed {
+    uint32_t baseSeed;
+    uint32_t episodeIdx;
+};
+
+// Totals over a world's current episode. Counts are kept as floats so the
+// completed copy exports as a single float tensor.
+struct EpisodeStats {
+    float hiderTeamReturn;
+    float episodeLength;
+    float numHiderSeenSteps; // steps where a seeker saw any hider
+    float numGrabs; // including the prep phase
+    float numLocks; // including the prep phase
+    float numOutOfBounds; // agent steps that took the out of bounds penalty
+};
+
+// The last episode this world finished, copied from EpisodeStats at reset.
+// numEpisodes counts completed episodes so new entries can be detected.
+struct CompletedEpisodeStats {
+    float numEpisodes;
+    EpisodeStats stats;
+};
+
+// Per agent slot flags, set from Python: slots with a nonzero flag get their
+// Action filled in by scriptedPolicySystem rather than by the trainer. Kept
+// per world so the flags survive resets, unlike the AgentInterface entities.
+struct ScriptedAgents {
+    int32_t scripted[consts::maxAgents];
+};
+
+// Policy IDs in [0, numPolicies) driving each team in this world, set from
+// Python.
+struct PolicyAssignment {
+    int32_t hiderPolicy;
+    int32_t seekerPolicy;
+};
+
+// Written at the end of every step for the Manager's grouping sort: each
+// agent slot's group (hider policies first, then seeker policies, -1 for
+// empty slots and cameras) and the row its AgentInterface occupies.
+struct PolicyGroupKeys {
+    int32_t key[consts::maxAgents];
+    int32_t row[consts::maxAgents];
+};
+
+// Ring index this world records into on the current step, latched at the
+// start of the step so observations and rewards land in the same row.
+struct RolloutCursor {
+    int32_t step;
+};
+
 struct AgentPrepCounter {
     int32_t numPrepStepsLeft;
 };
@@ -61,6 +134,37 @@ struct GrabData {
     Entity constraintEntity;
 };
 
+// Rotation about the z axis. Boxes, ramps and agents only yaw during normal
+// play, so observations use this instead of the full quaternion.
+struct Yaw {
+    float yaw;
+};
+
+inline float quatToYaw(madrona::math::Quat q)
+{
+    return atan2f(2.f * (q.w * q.z + q.x * q.y),
+                  1.f - 2.f * (q.y * q.y + q.z * q.z));
+}
+
+inline float wrapAngle(float angle)
+{
+    if (angle > madrona::math::pi) {
+        angle -= 2.f * madrona::math::pi;
+    } else if (angle <= -madrona::math::pi) {
+        angle += 2.f * madrona::math::pi;
+    }
+
+    return angle;
+}
+
+// Unlocked boxes and ramps that stay at rest are put to sleep by switching
+// them to ResponseType::Static, which drops them out of integration and the
+// solver. asleep distinguishes them from locked objects.
+struct SleepState {
+    int32_t numQuietSteps;
+    int32_t asleep;
+};
+
 enum class AgentType : uint32_t {
     Seeker = 0,
     Hider = 1,
@@ -80,7 +184,9 @@ struct DynamicObject : public madrona::Archetype<
     ExternalForce,
     ExternalTorque,
     madrona::phys::broadphase::LeafID,
-    OwnerTeam
+    OwnerTeam,
+    Yaw,
+    SleepState
 > {};
 
 struct Action {
@@ -105,6 +211,37 @@ struct GlobalDebugPositions {
     madrona::math::Vector2 agentPositions[consts::maxAgents];
 };
 
+// World-frame state of every observable object, gathered once per world per
+// step. Slots are ordered boxes, ramps, then agents (in agentInterfaces
+// order); inactive slots are zeroed and have valid == 0.
+// Bit i of staticCached is set while box / ramp slot i is Static (locked) and
+// its entry is up to date, so the gather can skip it until it is unlocked.
+struct WorldFrameObjects {
+    uint32_t staticCached;
+    float posX[consts::maxTrackedObjects];
+    float posY[consts::maxTrackedObjects];
+    float velX[consts::maxTrackedObjects];
+    float velY[consts::maxTrackedObjects];
+    float valid[consts::maxTrackedObjects];
+    float yaw[consts::maxBoxes + consts::maxRamps];
+    Entity agentInterfaces[consts::maxAgents];
+};
+
+// FNV-1a hash of the world's simulation state at the end of the step, for
+// comparing runs bit for bit. Only computed when enableStateHash is set.
+struct StateHash {
+    uint64_t hash;
+};
+
+// World space AABBs of the axis aligned static walls, captured once per
+// episode after level generation so the occupancy grid doesn't have to look
+// up each wall's hull every step. Rotated walls and anything past
+// maxStaticBoxes are left out.
+struct StaticGeometry {
+    int32_t numBoxes;
+    madrona::math::AABB boxes[consts::maxStaticBoxes];
+};
+
 struct AgentObservation {
     madrona::math::Vector2 pos;
     madrona::math::Vector2 vel;
@@ -151,12 +288,33 @@ struct Lidar {
     float depth[30];
 };
 
+// The world's base seed and the world-local index of the current episode.
+// Together they determine the episode's level RNG, and they are unique
+// across worlds as long as the base seeds are.
 struct Seed {
-    int32_t seed;
+    int32_t worldSeed;
+    int32_t episodeIdx;
+};
+
+// Egocentric top-down occupancy map: an occupancyGridSize^2 window of
+// occupancyCellSize cells centred on the agent and turned with its yaw, so
+// rows run along the agent's forward axis. Bit x of rows[y] is set when the
+// centre of cell (x, y) lies inside a wall, box, ramp or other agent.
+struct OccupancyGrid {
+    uint32_t rows[consts::occupancyGridSize];
 };
 
+static_assert(consts::occupancyGridSize <= 32);
+
 static_assert(sizeof(Action) == 5 * sizeof(int32_t));
 
+// Where a scripted agent last saw a member of the opposing team.
+// stepsSinceSeen is -1 until it has seen one this episode.
+struct ScriptedMemory {
+    madrona::math::Vector2 lastSeenPos;
+    int32_t stepsSinceSeen;
+};
+
 struct AgentInterface : public madrona::Archetype<
     SimEntity,
     AgentPrepCounter,
@@ -170,9 +328,28 @@ struct AgentInterface : public madrona::Archetype<
     BoxVisibilityMasks,
     RampVisibilityMasks,
     Lidar,
-    Seed
+    Seed,
+    OccupancyGrid,
+    ScriptedMemory
 > {};
 
+// The frozen MLP policy reads an agent's observations flattened in exported
+// tensor order (prep counter, agent, box and ramp data, the three visibility
+// masks, lidar) and outputs logits for the x, y and r (11 buckets each) and
+// grab and lock (2 each) action heads.
+inline constexpr int32_t frozenPolicyNumInputs = (
+    sizeof(AgentPrepCounter) +
+    sizeof(RelativeAgentObservations) +
+    sizeof(RelativeBoxObservations) +
+    sizeof(RelativeRampObservations) +
+    sizeof(AgentVisibilityMasks) +
+    sizeof(BoxVisibilityMasks) +
+    sizeof(RampVisibilityMasks) +
+    sizeof(Lidar)) / sizeof(float);
+inline constexpr int32_t frozenPolicyNumOutputs = 3 * 11 + 2 * 2;
+
+static_assert(frozenPolicyNumInputs <= MLPWeights::maxWidth);
+
 struct CameraAgent : public madrona::Archetype<
     Position,
     Rotation,
@@ -194,6 +371,7 @@ struct DynAgent : public madrona::Archetype<
     ExternalTorque,
     madrona::phys::broadphase::LeafID,
     OwnerTeam,
+    Yaw,
     GrabData,
     madrona::render::BatchRenderCamera,
     madrona::viz::VizCamera
@@ -210,9 +388,16 @@ struct Sim : public madrona::WorldBase {
         const Config &cfg,
         const WorldInit &init);
 
-    EpisodeManager *episodeMgr;
     float *rewardBuffer;
     uint8_t *doneBuffer;
+    float *depthBuffer;
+    int32_t depthWidth;
+    int32_t depthHeight;
+    RolloutBuffers rollout;
+    MLPWeights frozenPolicy;
+    AgentType frozenTeam;
+    int32_t numPolicies;
+    TeamBuffers team;
     RNG rng;
 
     Entity *obstacles;
@@ -234,15 +419,18 @@ struct Sim : public madrona::WorldBase {
     CountT numActiveAgents;
 
     CountT curEpisodeStep;
+    bool countEpisodeStats;
     CountT minEpisodeEntities;
     CountT maxEpisodeEntities;
 
-    uint32_t curEpisodeSeed;
+    Seed curEpisodeSeed;
     bool enableBatchRender;
     bool enableViewer;
     bool autoReset;
 
     madrona::AtomicFloat hiderTeamReward {0};
+    madrona::AtomicI32 numGrabEvents {0};
+    madrona::AtomicI32 numLockEvents {0};
 };
 
 class Engine : public ::madrona::CustomContext<Engine, Sim> {